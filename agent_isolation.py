@@ -4,7 +4,7 @@ agent_isolation.py
 
 Agente para ns3-gym que:
  - coleta features por nó (traffic, packet_rate, latency, energy, ...)
- - faz um warmup (coleta de N passos sem isolar) para aprender comportamento normal
+ - faz um warmup (coleta de N segundos simulados sem isolar) para aprender comportamento normal
  - treina um IsolationForest (scikit-learn) com dados do warmup
  - em cada passo, prevê anomalias e envia ações de isolamento via env.step(action)
  - faz proteção simples (taxa máxima de isolamentos, cooldown, whitelist do AP, logging)
@@ -46,22 +46,71 @@ logger = logging.getLogger("agent_isolation")
 # -----------------------------
 # Parâmetros do agente
 # -----------------------------
-DEFAULT_WARMUP_STEPS = 150        # passos coletados antes de treinar o IsolationForest
+DEFAULT_IDLE_S = 15               # segundos simulados ignorados (arranque/rampa)
+DEFAULT_WARMUP_S = 150            # segundos simulados coletados antes de treinar o IsolationForest
 DEFAULT_CONTAMINATION = 0.05      # proporção esperada de anomalias
 MAX_ISOLATIONS_PER_STEP = 5        # limite de quantos nós isolar por passo
-ISOLATION_COOLDOWN = 10            # passos para manter nó isolado antes de poder reativar
-MAX_TOTAL_ISOLATIONS = None        # limitador global (None = sem limite)
+ISOLATION_COOLDOWN = 10            # segundos simulados de isolamento antes de poder reativar
+MAX_TOTAL_ISOLATIONS = 20          # limite de nós isolados ao mesmo tempo (= --max-total-isolations)
 
 # -----------------------------
 # Funções utilitárias
 # -----------------------------
 
+# Reconstrói a matriz densa (N, F) de uma observação --obsEncoding=sparse:
+# {"idx": (k,), "val": (k, F), "summary": [N, F, k, soma_col0, ...]}.
+# Linhas omitidas (abaixo do limiar no ns-3) viram zero.
+def expand_sparse_obs(obs):
+    summary = np.asarray(obs["summary"], dtype=float).ravel()
+    N, F = int(summary[0]), int(summary[1])
+    idx = np.asarray(obs["idx"], dtype=np.int64).ravel()
+    val = np.asarray(obs["val"], dtype=float).reshape((idx.size, F))
+    dense = np.zeros((N, F), dtype=float)
+    dense[idx] = val
+    return dense if F > 1 else dense.ravel()
+
+
+# Desfaz --obsEncoding=quant8/quant16: {"q": (N,) ou (N, F), "scale": (F,),
+# "offset": (F,)} -> offset + q * scale, coluna a coluna.
+def dequantize_obs(obs):
+    scale = np.asarray(obs["scale"], dtype=float).ravel()
+    offset = np.asarray(obs["offset"], dtype=float).ravel()
+    q = np.asarray(obs["q"], dtype=float)
+    if q.ndim == 1:
+        return offset[0] + q * scale[0]
+    return offset + q * scale
+
+
+# Intervalos empilhados por observação (--stackK do ns-3); ajustado por --stack-k
+OBS_STACK_K = 1
+
+
+# Desfaz --stackK=K: (K, N) ou (K, N, F), mais antigo primeiro -> (N, K*F),
+# com o intervalo mais recente nas primeiras F colunas (X[:, 0] continua a ser
+# o tráfego atual do nó).
+def unstack_obs(a, k):
+    if a.ndim == 1:
+        a = a.reshape((k, -1))
+    if a.ndim == 2:
+        a = a[:, :, None]
+    a = a[::-1]
+    return a.transpose(1, 0, 2).reshape((a.shape[1], -1))
+
+
 # Transforma a observação do ambiente em uma matriz de features (N_nodes, F) e uma lista de node_ids
 def extract_node_features(obs):
 
+    # Modos esparso e quantizado do ns-3: decodifica antes de seguir pelo caminho denso
+    if isinstance(obs, dict) and "idx" in obs and "summary" in obs:
+        obs = expand_sparse_obs(obs)
+    elif isinstance(obs, dict) and "q" in obs and "scale" in obs:
+        obs = dequantize_obs(obs)
+
     # Adapta-se automaticamente a observações 1D (N,) ou 2D (N, F) do ns3-gym.    
     # Retorna (X, node_ids).
     a = np.array(obs, dtype=float)
+    if OBS_STACK_K > 1:
+        a = unstack_obs(a, OBS_STACK_K)
 
     # Caso 2D (N, F)
     if a.ndim == 2:
@@ -89,18 +138,197 @@ def extract_node_features(obs):
     raise ValueError(f"Formato de observação não reconhecido: tipo={type(obs)}, shape={getattr(a, 'shape', None)}")
 
 
+# Tabela de identidade dos nós (ddos_node_info.h): chega uma única vez, no info
+# do primeiro estado ("nodes=idx,ip,pan,papel|...;t=..;wave=..;isolated=..");
+# os infos seguintes trazem só os pares dinâmicos "chave=valor;".
+class NodeDirectory:
+    def __init__(self):
+        self.labels = {}   # idx -> endereço IPv6
+        self.group = {}    # idx -> PAN / rede
+        self.role = {}     # idx -> normal | atk1 | atk2 | atk
+        self.dyn = {}      # últimos pares dinâmicos (t, wave, isolated, step)
+        self.elapsed = 0.0 # segundos simulados até a observação atual
+
+    def update(self, info):
+        if not info or not isinstance(info, str):
+            return
+        for pair in info.split(";"):
+            key, sep, val = pair.partition("=")
+            if not sep:
+                continue
+            if key == "nodes":
+                self._load_table(val)
+            else:
+                self.dyn[key] = val
+        self._advance()
+
+    # Com --adaptiveStep um passo cobre de fineStep a coarseStep segundos:
+    # warmup e cooldown contam tempo simulado, não passos. Vale o 't' do
+    # cenário; sem ele, soma o 'step' de cada info (ou 1 s por info), vezes
+    # --stack-k: o 'step' é só o último dos K intervalos da observação.
+    def _advance(self):
+        if "t" in self.dyn:
+            self.elapsed = float(self.dyn["t"])
+        else:
+            self.elapsed += float(self.dyn.get("step", 1.0)) * OBS_STACK_K
+
+    def _load_table(self, table):
+        for row in table.split("|"):
+            parts = row.split(",")
+            if len(parts) != 4:
+                continue
+            idx = int(parts[0])
+            self.labels[idx] = parts[1]
+            self.group[idx] = int(parts[2])
+            self.role[idx] = parts[3]
+        logger.info("Tabela de identidade recebida: %d nós", len(self.labels))
+
+    def label(self, idx):
+        return self.labels.get(idx, f"Node {idx}")
+
+    # Ground truth do passo atual: o nó pertence à onda de ataque ativa?
+    def is_attacking(self, idx):
+        wave = self.dyn.get("wave", "0")
+        role = self.role.get(idx, "normal")
+        return wave != "0" and role in ("atk", "atk" + wave)
+
+
+# Info do primeiro estado, consumido antes do primeiro step():
+# no ns3gym pelo construtor do Ns3Env, no shm pelo reset()
+def initial_extra_info(env):
+    bridge = getattr(env, "ns3ZmqBridge", None)
+    if bridge is not None:
+        return bridge.get_extra_info()
+    last = getattr(env, "last", None)
+    return last[3] if last else None
+
+
+# Contadores do passo calculados pelo cenário (ddos_reward.h): tp, fp, fn
+def step_counts(info):
+    out = {}
+    if isinstance(info, str):
+        for pair in info.split(";"):
+            key, sep, val = pair.partition("=")
+            if sep and key in ("tp", "fp", "fn"):
+                out[key] = int(val)
+    return out
+
+
+# --delta-actions: manda ao ns-3 só os nós cuja ação mudou, no formato
+# esparso [-1, i0, a0, i1, a1, ...] do ddos_action_delta.h, com os valores
+# reais (graduados no --actionMode=rate). A primeira ação de cada episódio e
+# as que mudam muitos nós (esparso >= denso) seguem densas.
+# O resto do Ns3Env (reset, action_space, ns3ZmqBridge, ...) passa direto.
+class DeltaActionEnv:
+    def __init__(self, env):
+        self.env = env
+        self.prev = None
+
+    def __getattr__(self, name):
+        return getattr(self.env, name)
+
+    def reset(self):
+        self.prev = None
+        return self.env.reset()
+
+    def step(self, action):
+        cur = np.asarray(action, dtype=np.float32).ravel().copy()
+        if self.prev is None or len(self.prev) != len(cur):
+            self.prev = cur
+            return self.env.step(cur)
+        changed = np.flatnonzero(cur != self.prev)
+        self.prev = cur
+        if 1 + 2 * len(changed) >= len(cur):
+            return self.env.step(cur)
+        sparse = np.empty(1 + 2 * len(changed), dtype=np.float32)
+        sparse[0] = -1.0
+        sparse[1::2] = changed
+        sparse[2::2] = cur[changed]
+        return self.env.step(sparse)
+
+
+# --action-mode rate: o ns-3 com --actionMode=rate lê a ação como a fração
+# da taxa base que o gateway deixa passar (1 = sem limite). O agente segue
+# decidindo quanto isolar (0 = nada, 1 = tudo, valores intermediários
+# permitidos); aqui a decisão vira fração liberada, 1 - a.
+class RateActionEnv:
+    def __init__(self, env):
+        self.env = env
+
+    def __getattr__(self, name):
+        return getattr(self.env, name)
+
+    def step(self, action):
+        a = np.clip(np.asarray(action, dtype=np.float32).ravel(), 0.0, 1.0)
+        return self.env.step(1.0 - a)
+
+
+# Comprimento médio de caminho c(n) de uma busca mal sucedida numa BST (o
+# mesmo _average_path_length do scikit-learn)
+def _average_path_length(n):
+    if n <= 1:
+        return 0.0
+    if n == 2:
+        return 1.0
+    return 2.0 * (np.log(n - 1.0) + np.euler_gamma) - 2.0 * (n - 1.0) / n
+
+
+# Exporta um IsolationForest treinado para o detector nativo do ns-3
+# (ddos_native_detector.h, --aiMode=iforest). Texto simples:
+#   ddos-iforest 1
+#   nTrees nFeatures norm offset gate
+#   por árvore: nNodes e uma linha "feature threshold left value" por nó
+# Nós em ordem BFS com o filho direito logo após o esquerdo (left + 1);
+# feature = -1 marca folha, cujo value já é profundidade + c(amostras).
+# norm = nTrees * c(max_samples), offset = offset_ do modelo e gate = limite
+# 3-sigma de bytes/s usado na filtragem dupla.
+def export_forest(model, path, gate):
+    n_features = int(model.n_features_in_)
+    norm = len(model.estimators_) * _average_path_length(model.max_samples_)
+    with open(path, "w") as f:
+        f.write("ddos-iforest 1\n")
+        f.write("%d %d %.17g %.17g %.17g\n" % (len(model.estimators_), n_features, norm,
+                                               float(model.offset_), float(gate)))
+        for est, feats in zip(model.estimators_, model.estimators_features_):
+            t = est.tree_
+            order, depth, queue = [], {0: 0}, [0]
+            while queue:
+                node = queue.pop(0)
+                order.append(node)
+                if t.children_left[node] != -1:
+                    for child in (t.children_left[node], t.children_right[node]):
+                        depth[child] = depth[node] + 1
+                        queue.append(child)
+            new_id = {node: i for i, node in enumerate(order)}
+            f.write("%d\n" % len(order))
+            for node in order:
+                if t.children_left[node] == -1:
+                    value = depth[node] + _average_path_length(t.n_node_samples[node])
+                    f.write("-1 0 0 %.9g\n" % value)
+                    continue
+                # x <= thr vai à esquerda; arredonda para baixo em float32 para a
+                # comparação x > thr do C++ dar o mesmo lado
+                thr = np.float32(t.threshold[node])
+                if thr > t.threshold[node]:
+                    thr = np.nextafter(thr, np.float32(-np.inf))
+                f.write("%d %.9g %d 0\n" % (int(feats[t.feature[node]]), float(thr),
+                                             new_id[t.children_left[node]]))
+    logger.info("IsolationForest exportado para %s (%d árvores, %d features)",
+                path, len(model.estimators_), n_features)
+
+
 # -----------------------------
 # Agente principal
 # -----------------------------
 class IsolationIsolationAgent:
-    def __init__(self, env, warmup_steps=DEFAULT_WARMUP_STEPS,
+    def __init__(self, env, warmup_s=DEFAULT_WARMUP_S,
                  contamination=DEFAULT_CONTAMINATION,
                  max_isolations_per_step=MAX_ISOLATIONS_PER_STEP,
                  isolation_cooldown=ISOLATION_COOLDOWN,
                  max_total_isolations=MAX_TOTAL_ISOLATIONS):
         self.env = env
-        self.idle_steps = 15     # Ignora os primeiros 15s (fase de arranque/rampa)
-        self.warmup_steps = warmup_steps
+        self.idle_s = DEFAULT_IDLE_S  # Ignora os primeiros 15s (fase de arranque/rampa)
+        self.warmup_s = warmup_s
         self.contamination = contamination
         self.max_isolations_per_step = max_isolations_per_step
         self.isolation_cooldown = isolation_cooldown
@@ -110,29 +338,42 @@ class IsolationIsolationAgent:
         self.feature_buffer = []  # Lista de arrays (N_nodes, F) dos passos de warmup (aplanados)
         self.total_isolated = 0
 
-        # Estado de isolamento por nó: dict node_id -> steps_remaining (>=1 se isolado)
+        # Estado de isolamento por nó: dict node_id -> instante (s simulados) de reativação
         self.isolated_until = {}
 
         # Whitelist opcional (ex: não isolar APs)
         self.whitelist_node_ids = set()  # Preencher se quiser ex: {ap_index}
 
+        self.nodes = NodeDirectory()
+        self.nodes.update(initial_extra_info(env))
+
     def warmup_and_train(self):
-        logger.info("Iniciando a simulação... Aguardando %d passos para a rede estabilizar.", self.idle_steps)
+        logger.info("Iniciando a simulação... Aguardando %.0f s para a rede estabilizar.", self.idle_s)
         obs = self.env.reset() 
+        self.nodes.update(initial_extra_info(self.env))
 
         # Fase de espera - Ignora os dados iniciais enquanto os nós acordam
-        for step in range(self.idle_steps):
+        start = self.nodes.elapsed
+        while self.nodes.elapsed - start < self.idle_s:
             _, node_ids = extract_node_features(obs)
             # Gera uma ação neutra - array de zeros
             neutral_action = self.build_neutral_action_for_env(len(node_ids))
 
             # Envia uma ação neutra (sem isolamento)
             obs, reward, done, info = self.env.step(neutral_action)
+            self.nodes.update(info)
             if done: return
 
         # Fase de treino - Capturar dados limpos da rede estabilizada
-        logger.info("Rede estabilizada! Coletando %d passos para treinar a IA...", self.warmup_steps)
-        for step in range(self.warmup_steps):
+        logger.info("Rede estabilizada! Coletando %.0f s para treinar a IA...", self.warmup_s)
+        start = self.nodes.elapsed
+        while self.nodes.elapsed - start < self.warmup_s:
+            # Baseline só com tráfego normal: um warmup que alcança a onda de
+            # ataque (--warmup longo, passos de K intervalos) para aqui
+            if self.nodes.dyn.get("wave", "0") != "0":
+                logger.warning("Onda de ataque em t=%.0f s: warmup encerrado com %.0f s de %.0f (reduza --warmup)",
+                               self.nodes.elapsed, self.nodes.elapsed - start, self.warmup_s)
+                break
             # Armazena as features de cada nó para treinar o modelo depois
             X_nodes, node_ids = extract_node_features(obs)
             self.feature_buffer.append(X_nodes)
@@ -140,8 +381,13 @@ class IsolationIsolationAgent:
             # Envia uma ação neutra (sem isolamento) durante o warmup
             neutral_action = self.build_neutral_action_for_env(len(node_ids))
             obs, reward, done, info = self.env.step(neutral_action)
+            self.nodes.update(info)
             if done: return
 
+        if not self.feature_buffer:
+            logger.error("Nenhum passo de tráfego normal no warmup; a IA fica sem modelo (ação neutra).")
+            return
+
         # Construi dataset e treina o Isolation Forest
         all_rows = []
         for step_arr in self.feature_buffer:
@@ -150,8 +396,10 @@ class IsolationIsolationAgent:
         X = np.vstack(all_rows)
         
         # Calcula a MÉDIA (e não o máximo) com base nos dados coletados do tráfego comum
-        self.mean_normal_traffic = float(np.mean(X))
-        self.std_normal_traffic = float(np.std(X))
+        # Só a coluna 0 (bytes/s): com --obsFeatures o ns-3 manda (N, F) e as
+        # demais features têm outras unidades
+        self.mean_normal_traffic = float(np.mean(X[:, 0]))
+        self.std_normal_traffic = float(np.std(X[:, 0]))
         self.limite_seguranca = self.mean_normal_traffic + (3 * self.std_normal_traffic)
         
         logger.info("Baseline -> Média: %.2f | Limite de Segurança (3-Sigma): %.2f Bytes/s", 
@@ -231,20 +479,8 @@ class IsolationIsolationAgent:
         X_nodes, node_ids = extract_node_features(obs)
         N = len(node_ids)
 
-        # Mapeamento de nomes IP
-        node_labels = {}
-        if info_str and isinstance(info_str, str):
-            try:
-                # Remove a barra | da string com os IPs, transforma numa lista
-                parts = info_str.strip("|").split("|")
-                # Mapeia cada parte "idx=ip" para o dicionário node_labels
-                for p in parts:
-                    if "=" in p:
-                        idx_s, ip_s = p.split("=")
-                        node_labels[int(idx_s)] = ip_s
-            # Caso em que a string vem corrompida é ignorado no mapeamento, usando o ID numérico
-            except Exception:
-                pass
+        # Só pares dinâmicos; a tabela de endereços chegou no primeiro info
+        self.nodes.update(info_str)
 
         # Caso a IA não tenha sido treinada (ex: falha no dataset), retorna ação neutra para evitar erros
         if self.model is None:
@@ -262,7 +498,7 @@ class IsolationIsolationAgent:
         # Preenche a lista de nós com info sobre a previsão e score para filtragem e logging
         candidates = []
         for i, nid in enumerate(node_ids):
-            label = node_labels.get(nid, f"Node {nid}")
+            label = self.nodes.label(nid)
             candidates.append((nid, int(preds[i]), float(scores[i]), X_nodes[i], label))
             
             traffic_val = X_nodes[i][0]
@@ -272,20 +508,21 @@ class IsolationIsolationAgent:
 
         # Gerencimento do Cooldown
         to_remove = []
-        # Percorre lista de nós isolados e decrementa o contador de cooldown
+        # Percorre lista de nós isolados e compara com o tempo simulado atual
+        now = self.nodes.elapsed
         for nid in list(self.isolated_until.keys()):
-            self.isolated_until[nid] -= 1
             # Tempo de isolamento (20s) expirou, nó é adicionado a lista de reativação
-            if self.isolated_until[nid] <= 0:
+            if now >= self.isolated_until[nid]:
                 to_remove.append(nid)
         # Remove os nós que expiraram do isolamento
         for nid in to_remove:
             del self.isolated_until[nid]
-            label = node_labels.get(nid, f"Node {nid}") 
+            label = self.nodes.label(nid) 
             logger.info("%s reativado (cooldown expirado).", label)
 
-        # Defini limite de isolamentos
-        allowed = self.max_isolations_per_step 
+        # Defini limite de isolamentos: por passo e no total simultâneo
+        allowed = min(self.max_isolations_per_step,
+                      max(0, self.max_total_isolations - len(self.isolated_until)))
 
         # Filtragem dupla
         anomalous = [c for c in candidates if c[1] == -1 and c[0] not in self.whitelist_node_ids]
@@ -311,7 +548,7 @@ class IsolationIsolationAgent:
         # Executa ação de isolamento
         action = np.zeros(N, dtype=int)
         for i, nid in enumerate(node_ids):
-            label = node_labels.get(nid, f"Node {nid}")
+            label = self.nodes.label(nid)
             
             # Verifica nó isolado ou escolhido para isolamento
             if nid in chosen or nid in self.isolated_until:
@@ -321,7 +558,7 @@ class IsolationIsolationAgent:
                 # Verifica nó escolhido para isolamento nesse passo
                 if nid in chosen:
                     # Marca início do isolamento de 20s
-                    self.isolated_until[nid] = self.isolation_cooldown
+                    self.isolated_until[nid] = now + self.isolation_cooldown
                     self.total_isolated += 1
                     sc = 0.0
                     for c in candidates: 
@@ -341,7 +578,7 @@ class IsolationIsolationAgent:
 # Loop principal
 def run_agent(env, args):
     agent = IsolationIsolationAgent(env,
-                                    warmup_steps=args.warmup,
+                                    warmup_s=args.warmup,
                                     contamination=args.contamination,
                                     max_isolations_per_step=args.max_isolations,
                                     isolation_cooldown=args.cooldown,
@@ -354,6 +591,9 @@ def run_agent(env, args):
     else:
         agent.warmup_and_train()
 
+    if args.export_forest and agent.model is not None:
+        export_forest(agent.model, args.export_forest, agent.limite_seguranca)
+
     obs = None
     done = False
     step_idx = 0
@@ -365,6 +605,8 @@ def run_agent(env, args):
         obs = env.reset()
 
     logger.info("Iniciando loop principal do agente...")
+    totals = {"tp": 0, "fp": 0, "fn": 0}
+    total_reward = 0.0
     while not done:
         current_info = info if 'info' in locals() else None
         
@@ -373,6 +615,9 @@ def run_agent(env, args):
         
         # Envia a ação para o ns-3
         obs, reward, done, info = env.step(action)
+        total_reward += float(reward or 0.0)
+        for key, val in step_counts(info).items():
+            totals[key] += val
         
         # Grava os dados da IA no CSV
         with open('metricas_ia.csv', mode='a', newline='') as file:
@@ -384,6 +629,9 @@ def run_agent(env, args):
             logger.info("Step %d done=%s. Isolados: %d | Max Score: %.3f", step_idx, done, nos_isol, score_max)
             
     logger.info("Env terminou. Agent steps: %d", step_idx)
+    tp, fp, fn = totals["tp"], totals["fp"], totals["fn"]
+    logger.info("Recompensa total %.1f | tp=%d fp=%d fn=%d | precisão %.3f recall %.3f",
+                total_reward, tp, fp, fn, tp / max(1, tp + fp), tp / max(1, tp + fn))
 
 # -----------------------------
 # CLI e execução
@@ -392,16 +640,55 @@ def main():
     parser = argparse.ArgumentParser()
     parser.add_argument("--env-id", type=str, default=None, help="ID do ambiente ns3-gym")
     parser.add_argument("--dataset", type=str, default=None, help="Caminho para o ficheiro CSV")
-    parser.add_argument("--warmup", type=int, default=150)
+    parser.add_argument("--warmup", type=float, default=DEFAULT_WARMUP_S,
+                        help="Segundos simulados de coleta antes de treinar (não passos: vale com --adaptiveStep)")
     parser.add_argument("--contamination", type=float, default=0.1)
     parser.add_argument("--max-isolations", type=int, default=5)
-    parser.add_argument("--cooldown", type=int, default=20)
+    parser.add_argument("--cooldown", type=float, default=20,
+                        help="Segundos simulados que um nó fica isolado")
     parser.add_argument("--max-total-isolations", type=int, default=20)
+    parser.add_argument("--stack-k", type=int, default=1,
+                        help="Igual ao --stackK do cenário (intervalos por observação)")
+    parser.add_argument("--export-forest", type=str, default=None,
+                        help="Grava o IsolationForest treinado para o --aiMode=iforest do ns-3; "
+                             "com --dataset só treina, exporta e sai")
+    parser.add_argument("--transport", choices=["zmq", "shm", "replay"], default="zmq",
+                        help="zmq (ns3gym), shm (cenário com --gymTransport=shm) ou replay "
+                             "(gravações --recordFile, sem ns-3)")
+    parser.add_argument("--shm-name", type=str, default="ddos_gym_5555",
+                        help="Segmento em /dev/shm criado pelo ns-3 (ddos_gym_<porta>)")
+    parser.add_argument("--replay-file", type=str, nargs="+", default=None,
+                        help="Gravações do --recordFile servidas no --transport replay")
+    parser.add_argument("--delta-actions", action="store_true",
+                        help="Envia só os nós cuja ação mudou (formato esparso do ddos_action_delta.h)")
+    parser.add_argument("--action-mode", choices=["binary", "rate"], default="binary",
+                        help="rate: para o ns-3 com --actionMode=rate (ação = fração liberada da taxa base)")
     
     args = parser.parse_args()
 
+    global OBS_STACK_K
+    OBS_STACK_K = max(1, args.stack_k)
+
+    # Só exportar o modelo treinado no dataset: não precisa do ns-3
+    if args.export_forest and args.dataset:
+        agent = IsolationIsolationAgent(None, contamination=args.contamination)
+        if not agent.train_with_weather_dataset(args.dataset):
+            raise SystemExit(1)
+        export_forest(agent.model, args.export_forest, agent.limite_seguranca)
+        return
+
     env = None
-    if args.env_id:
+    if args.transport == "shm":
+        from shm_env import ShmNs3Env
+        env = ShmNs3Env(name=args.shm_name)
+        logger.info("Ambiente criado via memória compartilhada (/dev/shm/%s)", args.shm_name)
+    elif args.transport == "replay":
+        if not args.replay_file:
+            raise SystemExit("--transport replay precisa de --replay-file")
+        from replay_env import ReplayNs3Env
+        env = ReplayNs3Env(args.replay_file, loop=False)
+        logger.info("Ambiente de replay: %s", ", ".join(args.replay_file))
+    if env is None and args.env_id:
         try:
             env = gym.make(args.env_id)
             logger.info("Ambiente criado via gym.make('%s')", args.env_id)
@@ -423,6 +710,10 @@ def main():
 
     if env is None:
         raise RuntimeError("Não foi possível criar o ambiente ns3-gym. Ajuste --env-id ou instale ns3gym.")
+    if args.delta_actions:
+        env = DeltaActionEnv(env)
+    if args.action_mode == "rate":
+        env = RateActionEnv(env)
 
     run_agent(env, args)
 
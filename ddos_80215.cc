@@ -2,7 +2,7 @@
 //  DDoS detection em ns-3 + ns3-gym, IEEE 802.15.4 (LR-WPAN) + 6LoWPAN
 //  TOPOLOGIA MULTI-PAN
 //
-//  Os 173 nos OBSERVADOS sao divididos em K PANs pequenas (~25 nos cada),
+//  Os nMonitored (default 173) nos OBSERVADOS sao divididos em K PANs pequenas (~25 nos cada),
 //  cada uma em seu proprio canal/coordenador. Os coordenadores e o servidor
 //  (vitima) ficam num BACKBONE CABEADO (CSMA), de alta capacidade.
 //
@@ -12,7 +12,7 @@
 //   - O trafego de todas as PANs em direcao a vitima e agregado no backbone
 //     CSMA (100 Mbps), nao no radio -> nenhum canal de radio vira gargalo.
 //
-//  A dimensao do espaco de observacao/acao do agente continua 173: o vetor e
+//  A dimensao do espaco de observacao/acao do agente e nMonitored: o vetor e
 //  indexado pelo no monitorado (monitoredNodes.Get(i)), independente da PAN.
 //
 //  Versao alvo: ns-3.40 (classes LrWpan* no namespace ns3; associacao via
@@ -34,11 +34,29 @@
 #include "ns3/propagation-module.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <fstream>   // se ainda nao tiver
 
+#include "ddos_action_delta.h"
+#include "ddos_adaptive_step.h"
+#include "ddos_blacklist_routing.h"
+#include "ddos_flow_sampler.h"
+#include "ddos_fork_branch.h"
+#include "ddos_gym_recorder.h"
+#include "ddos_native_detector.h"
+#include "ddos_node_info.h"
+#include "ddos_obs_encoding.h"
+#include "ddos_obs_history.h"
+#include "ddos_reward.h"
+#include "ddos_shm_gym.h"
+#include "ddos_source_policer.h"
+#include "ddos_step_timer.h"
+#include "ddos_trace_counters.h"
+
 
 NS_LOG_COMPONENT_DEFINE("DdosOpengym");
 
@@ -48,16 +66,53 @@ using namespace ns3;
 // ----------------------------------------------------------------------------
 //  Estado global usado pelos callbacks do Gym
 // ----------------------------------------------------------------------------
-static NodeContainer monitoredNodes;       // os 173 nos observados (flat, 0..172)
-static uint32_t g_nNodes = 173;            // dimensao da observacao/acao
+static NodeContainer monitoredNodes;       // nos observados (flat, 0..nMonitored-1)
+static uint32_t g_nNodes = 173;            // dimensao da observacao/acao (= nMonitored)
+static WallClockProfile g_prof;            // tempo de parede de setup/observacao/acao
+static bool g_traceObs = false;            // true: observacao via ddos_trace_counters.h
+static std::vector<TrafficFeature> g_obsFeat;  // features por no (--obsFeatures)
+static std::vector<double> g_ewmaHorizons; // horizontes (s) das features ewma*
+static bool g_featureObs = false;          // true: observacao N x F das features
+static std::vector<float> g_featBuf;       // matriz N x F do ultimo intervalo
+static ObsEncoding g_obsEnc = OBS_DENSE;   // --obsEncoding
+static float g_sparseThreshold = 0.0f;     // --sparseThreshold
+static uint32_t g_stackK = 1;              // --stackK (intervalos por chamada do agente)
+static ObservationStack g_obsStack;        // ultimas K linhas (so com stackK > 1)
+static std::vector<float> g_stackBuf;      // tensor K x N (x F) entregue ao agente
+static uint64_t g_stepTick = 0;            // intervalos de envStepTime ja decorridos
+static ZScoreDetector g_zscore;             // --aiMode=zscore: portao 3-sigma nativo
+static IsolationPolicy g_policy;           // orcamento por passo, cooldown e whitelist
+static std::vector<float> g_scores;        // -z por no no ultimo passo
+static NodeInfoChannel g_nodeInfo;         // tabela de identidade (so no 1o info)
+static uint32_t g_nIsolated = 0;           // nos isolados pela ultima acao
+static ApplicationContainer g_attackApps;  // OnOff dos atacantes (ramos mudam a taxa)
+static ActionDelta g_actionDelta;          // ultima decisao por no (so as mudancas sao aplicadas)
+static std::vector<Ptr<Ipv6>> g_nodeIpv6;  // Ipv6 de cada no monitorado, resolvido uma vez
+static std::vector<BranchSpec> g_branchSpecs; // --branches
+static BranchRunner g_branches;            // --forkAt: um filho por ramo
+static uint32_t g_forkJobs = 0;            // filhos simultaneos (0 = todos)
+static Ptr<GymRecorder> g_recorder;        // --recordFile: estados/acoes para o replay_env.py
+static bool g_adaptiveStep = false;        // --adaptiveStep: passo do agente segue o detector
+static AdaptiveStepper g_stepper;          // passo grosso/fino pela taxa recebida na vitima
+static ApplicationContainer g_sinkApps;    // sinks da vitima
+static EventId g_nextRead;                 // proxima leitura do agente (pode ser antecipada)
+static double g_lastRead = 0.0;            // instante (s) da ultima leitura
+static double g_stepLen = 0.0;             // intervalo coberto pela ultima observacao
+static RewardTracker g_reward;             // recompensa e tp/fp/fn do passo (ground truth do cenario)
+static Ptr<SourcePolicerTable> g_policer;  // --mitigation=policer|blacklist: tabela por origem nos coordenadores
+static uint64_t g_policerRate = 0;         // bps do bucket de um no isolado
+static uint32_t g_policerBurst = 0;        // bytes de rajada do bucket
+static uint64_t g_rateBaseline = 0;        // --actionMode=rate: taxa base por no (0 = acao binaria)
+static std::vector<Ipv6Address> g_nodeAddr; // endereco global de cada no monitorado (chave do policer)
 
 static FlowMonitorHelper flowmonHelper;
 static Ptr<FlowMonitor> flowMonitor;
 static Ptr<Ipv6FlowClassifier> ipv6Classifier;
-static std::map<uint32_t, uint64_t> lastRxBytesPerFlow;
+
+// Uma fotografia do FlowMonitor por segundo, compartilhada por log e observacao
+static FlowIntervalSampler g_flowSampler;
 
 static std::ofstream g_flowCsv;
-static std::map<ns3::FlowId, uint64_t> g_lastTxB, g_lastRxB;
 static std::string g_tag = "run";
 // ----------------------------------------------------------------------------
 //  FlowMonitor
@@ -69,40 +124,38 @@ void InstallFlowMonitor()
     if (ipv6Classifier == nullptr) {
         NS_LOG_WARN("Ipv6FlowClassifier indisponivel; mapeamento fluxo->endereco ausente.");
     }
-    lastRxBytesPerFlow.clear();
+    g_flowSampler.Install(flowMonitor, ipv6Classifier, monitoredNodes);
 }
 
-std::map<std::string, double> CollectNodeThroughputs(double intervalSeconds)
+// Bytes/s por no monitorado (indexado como monitoredNodes) no ultimo intervalo
+const std::vector<float>& FlowNodeTxRates()
 {
-    std::map<std::string, double> throughputBySrc;
-    if (!flowMonitor) return throughputBySrc;
-
-    flowMonitor->CheckForLostPackets();
-    auto stats = flowMonitor->GetFlowStats();
-    if (ipv6Classifier == nullptr) return throughputBySrc;
-
-    for (auto &kv : stats) {
-        FlowId fid = kv.first;
-        Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(fid);
-        std::ostringstream oss; oss << t.sourceAddress;
-        std::string src = oss.str();
-
-    uint64_t txBytes = kv.second.txBytes; 
-        uint64_t prev = lastRxBytesPerFlow.count(fid) ? lastRxBytesPerFlow[fid] : 0;
-        uint64_t delta = (txBytes >= prev) ? (txBytes - prev) : 0;
-        lastRxBytesPerFlow[fid] = txBytes;
-        throughputBySrc[src] += (double)delta / intervalSeconds;
-    }
-    return throughputBySrc;
+    g_flowSampler.Sample(FLOW_OBS);
+    return g_flowSampler.NodeTxRates();
 }
 
 // ----------------------------------------------------------------------------
 //  Callbacks do OpenGym (indexados pelo no monitorado, 0..g_nNodes-1)
 // ----------------------------------------------------------------------------
-Ptr<OpenGymSpace> MyGetObservationSpace(void)
+// {N} com uma feature por no, {N, F} com varias
+static uint32_t ObservationColumns()
 {
+    return g_featureObs ? TrafficFeatureColumns(g_obsFeat, g_ewmaHorizons.size()) : 1;
+}
+
+// {K, N} / {K, N, F} com --stackK=K > 1
+static std::vector<uint32_t> ObservationShape()
+{
+    uint32_t cols = ObservationColumns();
     std::vector<uint32_t> shape = {g_nNodes};
-    return CreateObject<OpenGymBoxSpace>(0.0, 1e9, shape, TypeNameGet<float>());
+    if (cols > 1) shape.push_back(cols);
+    if (g_stackK > 1) shape.insert(shape.begin(), g_stackK);
+    return shape;
+}
+
+Ptr<OpenGymSpace> MyGetObservationSpace(void)
+{
+    return EncodedObservationSpace(g_obsEnc, ObservationShape());
 }
 
 Ptr<OpenGymSpace> MyGetActionSpace(void)
@@ -112,92 +165,178 @@ Ptr<OpenGymSpace> MyGetActionSpace(void)
     return CreateObject<OpenGymBoxSpace>(low, high, shape, "float32");
 }
 
+// Linha N (ou N x F) do intervalo que acabou de fechar, em g_featBuf
+static void SampleObservationRow()
+{
+    if (g_featureObs) {
+        // Matriz N x F ja calculada incrementalmente durante o intervalo
+        TrafficFeatureMatrix(g_obsFeat, g_featBuf);
+    } else {
+        const std::vector<float> &tp = g_traceObs ? TrafficTxRates() : FlowNodeTxRates();
+        g_featBuf.assign(g_nNodes, 0.0f);
+        std::copy_n(tp.begin(), std::min<size_t>(tp.size(), g_nNodes), g_featBuf.begin());
+    }
+}
+
 Ptr<OpenGymDataContainer> MyGetObservation(void)
 {
-    std::vector<uint32_t> shape = {g_nNodes};
-    Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(shape);
-    std::map<std::string, double> tpMap = CollectNodeThroughputs(1.0);
+    ScopedWallTimer timer(g_prof, PROF_OBS);
+    std::vector<uint32_t> shape = ObservationShape();
 
-    for (uint32_t i = 0; i < g_nNodes && i < monitoredNodes.GetN(); i++) {
-        float val = 0.0f;
-        Ptr<Ipv6> ipv6 = monitoredNodes.Get(i)->GetObject<Ipv6>();
-        if (ipv6) {
-            for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-                if (ipv6->GetNAddresses(ifIdx) < 2) continue;
-                std::ostringstream oss; oss << ipv6->GetAddress(ifIdx, 1).GetAddress();
-                if (tpMap.count(oss.str())) val = (float)tpMap[oss.str()];
-            }
-        }
-        box->AddValue(val);
+    // Com stackK > 1 as linhas ja foram amostradas a cada intervalo
+    if (g_stackK > 1) {
+        g_obsStack.Flatten(g_stackBuf);
+        return EncodeObservation(g_obsEnc, shape, g_stackBuf, g_sparseThreshold);
     }
-
-    std::vector<float> data = box->GetData();
-    std::stringstream ss; ss << "[";
-    for (size_t i = 0; i < data.size(); ++i) { ss << data[i]; if (i+1<data.size()) ss << ", "; }
-    ss << "]";
-    NS_LOG_UNCOND("MyGetObservation [t=" << Simulator::Now().GetSeconds() << "s]: " << ss.str());
-    return box;
+    SampleObservationRow();
+
+    // Vetor inteiro so com log de debug: com milhares de nos formatar N floats
+    // por passo custa mais que a propria observacao
+    if (g_log.IsEnabled(LOG_DEBUG)) {
+        const std::vector<float> &data = g_featBuf;
+        std::stringstream ss; ss << "[";
+        for (size_t i = 0; i < data.size(); ++i) { ss << data[i]; if (i+1<data.size()) ss << ", "; }
+        ss << "]";
+        NS_LOG_DEBUG("MyGetObservation [t=" << Simulator::Now().GetSeconds() << "s]: " << ss.str());
+    }
+    return EncodeObservation(g_obsEnc, shape, g_featBuf, g_sparseThreshold);
 }
 
-float MyGetReward(void) { return 1.0; }
+float MyGetReward(void)
+{
+    g_reward.Update();
+    return g_reward.GetReward();
+}
 bool  MyGetGameOver(void) { return Now().GetSeconds() >= 900.0; }
 
 std::string MyGetExtraInfo(void)
 {
-    std::stringstream ss;
-    for (uint32_t i = 0; i < monitoredNodes.GetN(); ++i) {
-        Ptr<Ipv6> ipv6 = monitoredNodes.Get(i)->GetObject<Ipv6>();
-        if (!ipv6) continue;
-        for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-            if (ipv6->GetNAddresses(ifIdx) < 2) continue;
-            ss << i << "=" << ipv6->GetAddress(ifIdx, 1).GetAddress() << "|";
-            break;
-        }
-    }
-    return ss.str();
+    g_reward.Update();
+    return g_nodeInfo.Next(DynamicStepInfo(g_nIsolated, g_stepLen) + ";" + g_reward.Info());
 }
 
 bool MyExecuteActions(Ptr<OpenGymDataContainer> action)
 {
+    ScopedWallTimer timer(g_prof, PROF_ACT);
     if (!action) return false;
     Ptr<OpenGymBoxContainer<float>> box = DynamicCast<OpenGymBoxContainer<float>>(action);
     if (!box) return false;
-    std::vector<float> actions = box->GetData();
 
-    for (uint32_t i = 0; i < actions.size() && i < monitoredNodes.GetN(); ++i) {
-        Ptr<Ipv6> ipv6 = monitoredNodes.Get(i)->GetObject<Ipv6>();
+    // So os nos cuja decisao mudou desde a ultima acao
+    for (uint32_t i : g_actionDelta.Update(box->GetData())) {
+        bool isolate = g_actionDelta.IsIsolated(i);
+        g_reward.SetIsolated(i, isolate);
+        if (g_policer) {   // na rede: o coordenador limita/barra a origem, o no segue transmitindo
+            double allowed = g_actionDelta.GetAllowed(i);
+            if (g_rateBaseline > 0 && allowed < 1.0)   // acao graduada: passa a * taxa base
+                g_policer->SetLimit(g_nodeAddr[i], (uint64_t)(allowed * g_rateBaseline), g_policerBurst);
+            else if (g_rateBaseline == 0 && isolate)
+                g_policer->SetLimit(g_nodeAddr[i], g_policerRate, g_policerBurst);
+            else
+                g_policer->Release(g_nodeAddr[i]);
+            continue;
+        }
+        Ptr<Ipv6> ipv6 = g_nodeIpv6[i];
         if (!ipv6) continue;
-        bool isolate = actions[i] > 0.5f;
         for (uint32_t ifIndex = 1; ifIndex < ipv6->GetNInterfaces(); ++ifIndex) {
             if (isolate && ipv6->IsUp(ifIndex))  ipv6->SetDown(ifIndex);
             if (!isolate && !ipv6->IsUp(ifIndex)) ipv6->SetUp(ifIndex);
         }
     }
+    g_nIsolated = g_actionDelta.GetNIsolated();
     return true;
 }
 
-void ScheduleNextStateRead(double envStepTime, Ptr<OpenGymInterface> openGym)
+// Liga os callbacks do cenario ao transporte escolhido (ZMQ ou shm)
+template <class Gym>
+static void ConnectGym(Ptr<Gym> gym)
+{
+    gym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
+    gym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
+    gym->SetGetObservationCb(MakeCallback(&MyGetObservation));
+    gym->SetGetRewardCb(MakeCallback(&MyGetReward));
+    gym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
+    gym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
+    gym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
+    if (g_recorder)
+        g_recorder->Attach(gym, MakeCallback(&MyGetObservation), MakeCallback(&MyGetReward),
+                           MakeCallback(&MyGetGameOver), MakeCallback(&MyGetExtraInfo),
+                           MakeCallback(&MyExecuteActions));
+}
+
+// 'notify' e o NotifyCurrentState do transporte em uso. Com stackK > 1 cada
+// intervalo vira uma linha do historico e o agente so e chamado a cada K
+// (ou no fim do episodio); a ultima acao vale ate la.
+void ScheduleNextStateRead(double envStepTime, Callback<void> notify)
+{
+    double now = Simulator::Now().GetSeconds();
+    g_stepLen = now - g_lastRead;
+    g_lastRead = now;
+    if (g_stackK > 1) {
+        SampleObservationRow();
+        g_obsStack.Push(g_featBuf);
+    }
+    if (g_stepTick++ % g_stackK == 0 || MyGetGameOver()) notify();
+    // Com --adaptiveStep o passo segue o detector; nenhum passo atravessa os
+    // 900 s, para o agente ver o gameOver
+    double next = g_adaptiveStep ? g_stepper.StepAt(now) : envStepTime;
+    if (now < 900.0) next = std::min(next, 900.0 - now);
+    g_nextRead = Simulator::Schedule(Seconds(next), &ScheduleNextStateRead, envStepTime, notify);
+}
+
+// Bytes recebidos ate agora pelos sinks da vitima
+static uint64_t VictimRxBytes()
 {
-    openGym->NotifyCurrentState();
-    Simulator::Schedule(Seconds(envStepTime), &ScheduleNextStateRead, envStepTime, openGym);
+    uint64_t rx = 0;
+    for (uint32_t i = 0; i < g_sinkApps.GetN(); ++i)
+        rx += DynamicCast<PacketSink>(g_sinkApps.Get(i))->GetTotalRx();
+    return rx;
+}
+
+// --adaptiveStep: sonda a taxa da vitima a cada fineStep; um disparo no meio
+// de um passo grosso antecipa a proxima leitura (no maximo fineStep depois
+// da ultima)
+void AdaptiveStepProbe(double envStepTime, Callback<void> notify)
+{
+    double now = Simulator::Now().GetSeconds();
+    double fine = g_stepper.GetFineStep();
+    if (g_stepper.Probe(now, VictimRxBytes())) {
+        Simulator::Cancel(g_nextRead);
+        double wait = std::max(0.0, g_lastRead + fine - now);
+        g_nextRead = Simulator::Schedule(Seconds(wait), &ScheduleNextStateRead, envStepTime, notify);
+    }
+    if (!MyGetGameOver()) Simulator::Schedule(Seconds(fine), &AdaptiveStepProbe, envStepTime, notify);
+}
+
+// --aiMode=zscore: a decisao final do agente (3-sigma sobre bytes/s) em C++,
+// sem OpenGym; a acao passa pelo MyExecuteActions de sempre
+void ZScoreStep(double envStepTime)
+{
+    uint32_t cols = ObservationColumns();
+    {
+        ScopedWallTimer timer(g_prof, PROF_OBS);
+        SampleObservationRow();
+        if (g_zscore.Score(g_featBuf.data(), g_nNodes, cols, g_scores))
+            NS_LOG_UNCOND("[ZSCORE] baseline: media " << g_zscore.GetMean() << " desvio " << g_zscore.GetStd()
+                          << " -> limite " << g_zscore.GetGate() << " B/s");
+    }
+    if (g_zscore.IsTrained()) g_policy.SetGate(g_zscore.GetGate());
+    const std::vector<float> &act = g_policy.Step(g_scores, g_featBuf.data(), cols);
+    Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{g_nNodes});
+    for (float a : act) box->AddValue(g_rateBaseline > 0 ? 1.0f - a : a);   // actionMode=rate: isolar = liberar 0
+    g_reward.Update();
+    MyExecuteActions(box);
+    if (!MyGetGameOver()) Simulator::Schedule(Seconds(envStepTime), &ZScoreStep, envStepTime);
 }
 
 void LogFlowPerSecond()
 {
-    if (flowMonitor && ipv6Classifier) {
-        flowMonitor->CheckForLostPackets();
-        auto stats = flowMonitor->GetFlowStats();
+    if (g_flowSampler.IsReady()) {
+        g_flowSampler.Sample(FLOW_CSV);
         double nTx=0, nRx=0, aTx=0, aRx=0;
-        for (auto &kv : stats) {
-            ns3::FlowId fid = kv.first;
-            const auto &fs = kv.second;
-            Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(fid);
-            uint64_t dtx = fs.txBytes - g_lastTxB[fid];
-            uint64_t drx = fs.rxBytes - g_lastRxB[fid];
-            g_lastTxB[fid] = fs.txBytes;
-            g_lastRxB[fid] = fs.rxBytes;
-            if (t.destinationPort == 9002) { nTx += dtx; nRx += drx; }
-            else if (t.destinationPort == 9001) { aTx += dtx; aRx += drx; }
+        for (const auto &f : g_flowSampler.Flows()) {
+            if (f.dstPort == 9002) { nTx += f.dTxBytes; nRx += f.dRxBytes; }
+            else if (f.dstPort == 9001) { aTx += f.dTxBytes; aRx += f.dRxBytes; }
         }
         double now = Simulator::Now().GetSeconds();
         g_flowCsv << now << ","
@@ -208,6 +347,78 @@ void LogFlowPerSecond()
     Simulator::Schedule(Seconds(1.0), &LogFlowPerSecond);
 }
 
+// Parametros de um ramo do --forkAt; com apply=false so valida
+static bool ApplyBranch(const BranchSpec &b, bool apply, std::string &err)
+{
+    for (const auto &kv : b.params) {
+        const std::string &key = kv.first, &val = kv.second;
+        char *end = nullptr;
+        if (key == "attackRate") {
+            DataRateValue rate;   // 0 = ataque desligado daqui em diante
+            if (g_attackApps.GetN() == 0 || !rate.DeserializeFromString(val == "0" ? "1bps" : val, MakeDataRateChecker())) {
+                err = "attackRate invalido no ramo " + b.name + ": " + val + " (exige --attack=true)";
+                return false;
+            }
+            for (uint32_t i = 0; apply && i < g_attackApps.GetN(); ++i)
+                g_attackApps.Get(i)->SetAttribute("DataRate", rate);
+        } else if (key == "maxIsolations" || key == "isolationCooldown") {
+            unsigned long n = std::strtoul(val.c_str(), &end, 10);
+            if (val.empty() || *end != '\0') {
+                err = key + " invalido no ramo " + b.name + ": " + val;
+                return false;
+            }
+            if (apply && key == "maxIsolations") g_policy.SetBudget(n, g_policy.GetCooldown());
+            if (apply && key == "isolationCooldown") g_policy.SetBudget(g_policy.GetMaxPerStep(), n);
+        } else if (key == "zSigmas") {
+            double z = std::strtod(val.c_str(), &end);
+            if (val.empty() || *end != '\0' || z <= 0.0) {
+                err = "zSigmas invalido no ramo " + b.name + ": " + val;
+                return false;
+            }
+            if (apply) g_zscore.SetSigmas(z);
+        } else {
+            err = "parametro desconhecido no ramo " + b.name + ": " + key
+                  + " (use attackRate, maxIsolations, isolationCooldown ou zSigmas)";
+            return false;
+        }
+    }
+    return true;
+}
+
+// --forkAt: o pai espera os ramos e para; cada filho aplica o seu ramo,
+// ganha arquivos de saida proprios e segue a simulacao
+void ForkBranches()
+{
+    g_flowCsv.flush();
+    int b = g_branches.Fork(g_branchSpecs.size(), g_forkJobs);
+    if (b < 0) {
+        Simulator::Stop();
+        return;
+    }
+    const BranchSpec &spec = g_branchSpecs[b];
+    std::string err;
+    ApplyBranch(spec, true, err);   // ja validado no main
+    g_tag += "-" + spec.name;
+    if (!BranchCopyOutput(g_flowCsv, "flowmon_persec_system.csv", "flowmon_persec_system-" + spec.name + ".csv"))
+        NS_LOG_WARN("ramo " << spec.name << ": falha ao copiar o CSV por segundo");
+    NS_LOG_UNCOND("[FORK] ramo " << spec.name << " (pid " << getpid() << ") a partir de t="
+                  << Simulator::Now().GetSeconds() << "s");
+}
+
+// Resumo do filho para o pai (ver colunas no ReportBranches do main)
+static std::string BranchSummary()
+{
+    g_flowSampler.Snapshot();
+    uint64_t nTx = 0, nRx = 0, aTx = 0, aRx = 0;
+    for (const auto &f : g_flowSampler.Flows()) {
+        if (f.dstPort == 9002) { nTx += f.txBytes; nRx += f.rxBytes; }
+        else if (f.dstPort == 9001) { aTx += f.txBytes; aRx += f.rxBytes; }
+    }
+    std::ostringstream ss;
+    ss << nTx << "," << nRx << "," << aTx << "," << aRx << "," << g_policy.GetTotalIsolations();
+    return ss.str();
+}
+
 void SaveFlowMonXml() {
     flowMonitor->CheckForLostPackets();
     flowMonitor->SerializeToXmlFile("ddos-flowmon-system-" + g_tag + ".xml", true, true);
@@ -219,6 +430,7 @@ void SaveFlowMonXml() {
 // =============================================================================
 int main(int argc, char* argv[])
 {
+    auto setupT0 = std::chrono::steady_clock::now();
     LogComponentEnable("DdosOpengym", LOG_LEVEL_INFO);
 
     // ---- Parametros (agora via CLI, para a varredura) ----
@@ -229,9 +441,43 @@ int main(int argc, char* argv[])
     bool attack    = false;             // varredura de baseline: SEM ataque
     bool staticNd  = true;              // (2) ND estatico STA<->coordenador
     bool tracing   = false;             // pcap desligado por padrao (varredura rapida)
+    std::string obsBackend = "flowmon"; // flowmon | trace (contadores por no via traces)
+    std::string obsFeatures = "txBytes"; // lista: txBytes,txPkts,meanSize,iatVar,delivery,delay,drops,ewmaBytes,ewmaPkts
+    std::string ewmaHorizons = "1,5,30"; // horizontes (s) de ewmaBytes/ewmaPkts
+    std::string obsEncoding = "dense";  // dense | sparse | quant8 | quant16
+    uint32_t openGymPort = 5555;          // uma porta por instancia (vec_env.py)
+    std::string gymTransport = "zmq";   // zmq | shm
+    std::string aiMode = "gym";           // gym (agente Python) | zscore (3-sigma nativo)
+    uint32_t maxIsolations = 5;           // novos isolamentos por passo (zscore)
+    uint32_t isolationCooldown = 20;      // passos isolado (zscore)
+    uint32_t maxTotalIsolations = 20;     // isolados ao mesmo tempo (zscore)
+    uint32_t zIdleSteps = 15;             // passos ignorados antes do warmup (zscore)
+    uint32_t zWarmupSteps = 150;          // passos de aprendizado do baseline (zscore)
+    double zSigmas = 3.0;                 // limite = media + zSigmas * desvio
+    std::string whitelist = "";           // indices nunca isolados, ex: 0,5
+    bool gymAsync = false;                // so com shm: acao aplicada depois de decisionLatency
+    double decisionLatency = 0.1;         // s (simulados) entre observacao e acao no modo async
+    double forkAt = 0.0;                  // s; > 0 liga os ramos (fork) a partir desse instante
+    std::string branches = "";            // ramos do forkAt, ex: semAtaque:attackRate=0;z2:zSigmas=2
+    std::string recordFile = "";          // grava a interacao com o agente (replay_env.py)
+    double coarseStep = 10.0;             // s; passo do agente com a rede dentro do baseline
+    double fineStep = 0.5;                // s; passo depois de um disparo (e periodo da sonda)
+    double stepHold = 20.0;               // s no passo fino depois do ultimo disparo
+    double stepIdle = 15.0;               // s ignorados antes de aprender o baseline da vitima
+    double stepLearn = 60.0;              // s de aprendizado do baseline
+    double stepSigmas = 4.0;              // disparo: |taxa - media| > stepSigmas * desvio
+    double rewardAttackWeight = 1.0;      // peso dos kB/s de ataque que chegam na vitima
+    double rewardBenignCost = 1.0;        // custo (kB/s equivalentes) por no isolado fora da onda
+    std::string mitigation = "node";      // node (interfaces do no isolado) | policer (token bucket no coordenador) | blacklist (RouteInput do coordenador)
+    std::string policerRate = "0bps";     // taxa permitida a um no isolado com mitigation=policer
+    uint32_t policerBurst = 0;            // rajada (bytes) do bucket de um no isolado
+    std::string actionMode = "binary";    // binary (a > 0.5 isola) | rate (a = fracao liberada da taxa base)
+    std::string rateBaseline = "";        // taxa base por no com actionMode=rate ("" = normalRate)
+    uint32_t rateLevels = 10;             // niveis da acao graduada (mudancas menores sao ignoradas)
     std::string tag = "run";
 
     CommandLine cmd(__FILE__);
+    cmd.AddValue("nMonitored",  "Nos monitorados (dimensao da observacao/acao)", nMonitored);
     cmd.AddValue("nodesPerPan", "Nos por PAN/canal 802.15.4", nodesPerPan);
     cmd.AddValue("normalRate",  "Taxa por no do trafego normal (ex: 200bps,100bps,50bps)", normalRate);
     cmd.AddValue("normalPkt",   "Bytes de payload por pacote normal", normalPkt);
@@ -239,8 +485,158 @@ int main(int argc, char* argv[])
     cmd.AddValue("staticNd",    "Pre-instala vizinhos estaticos (zera ND recorrente)", staticNd);
     cmd.AddValue("tracing",     "Habilita pcap", tracing);
     cmd.AddValue("tag",         "Sufixo dos arquivos de saida", tag);
+    cmd.AddValue("obsBackend",  "Fonte da observacao: flowmon ou trace (traces Ipv6/6LoWPAN)", obsBackend);
+    cmd.AddValue("obsFeatures", "Features por no, separadas por virgula (txBytes,txPkts,meanSize,iatVar,delivery,delay,drops,ewmaBytes,ewmaPkts)", obsFeatures);
+    cmd.AddValue("ewmaHorizons", "Horizontes EWMA em segundos, separados por virgula (ex: 1,5,30)", ewmaHorizons);
+    cmd.AddValue("obsEncoding", "Codificacao da observacao: dense, sparse (so linhas acima do limiar), quant8 ou quant16", obsEncoding);
+    cmd.AddValue("sparseThreshold", "Limiar do modo sparse: linha vai se algum valor passar dele", g_sparseThreshold);
+    cmd.AddValue("stackK", "Intervalos empilhados por chamada do agente (1 = uma chamada por envStepTime)", g_stackK);
+    cmd.AddValue("openGymPort", "Porta ZMQ do OpenGym; com shm o segmento e /dev/shm/ddos_gym_<porta>", openGymPort);
+    cmd.AddValue("gymTransport", "Transporte do OpenGym: zmq (socket) ou shm (memoria compartilhada)", gymTransport);
+    cmd.AddValue("aiMode", "Mitigacao: gym (agente Python via OpenGym) ou zscore (detector 3-sigma nativo)", aiMode);
+    cmd.AddValue("maxIsolations", "zscore: novos isolamentos por passo", maxIsolations);
+    cmd.AddValue("isolationCooldown", "zscore: passos que um no fica isolado", isolationCooldown);
+    cmd.AddValue("maxTotalIsolations", "zscore: maximo de nos isolados ao mesmo tempo", maxTotalIsolations);
+    cmd.AddValue("zIdleSteps", "zscore: passos ignorados antes do warmup", zIdleSteps);
+    cmd.AddValue("zWarmupSteps", "zscore: passos usados para media/desvio", zWarmupSteps);
+    cmd.AddValue("zSigmas", "zscore: limite = media + zSigmas * desvio", zSigmas);
+    cmd.AddValue("whitelist", "zscore: indices de nos que nunca sao isolados (virgula)", whitelist);
+    cmd.AddValue("gymAsync", "Nao para a simulacao esperando o agente (exige gymTransport=shm)", gymAsync);
+    cmd.AddValue("decisionLatency", "Latencia de decisao do agente no modo async, em segundos simulados", decisionLatency);
+    cmd.AddValue("forkAt", "Roda ate este instante (s) uma vez e faz fork de um filho por ramo (0 = desligado)", forkAt);
+    cmd.AddValue("branches", "Ramos do forkAt: nome:chave=valor,...;... (attackRate, maxIsolations, isolationCooldown, zSigmas)", branches);
+    cmd.AddValue("forkJobs", "Ramos rodando ao mesmo tempo (0 = todos)", g_forkJobs);
+    cmd.AddValue("recordFile", "Grava observacoes, info, reward e acoes do OpenGym neste arquivo binario (replay_env.py)", recordFile);
+    cmd.AddValue("adaptiveStep", "Passo do agente grosso na rede calma e fino quando a taxa da vitima muda", g_adaptiveStep);
+    cmd.AddValue("coarseStep", "adaptiveStep: passo (s) dentro do baseline", coarseStep);
+    cmd.AddValue("fineStep", "adaptiveStep: passo (s) apos um disparo e periodo da sonda", fineStep);
+    cmd.AddValue("stepHold", "adaptiveStep: segundos no passo fino apos o ultimo disparo", stepHold);
+    cmd.AddValue("stepIdle", "adaptiveStep: segundos ignorados antes do baseline", stepIdle);
+    cmd.AddValue("stepLearn", "adaptiveStep: segundos de aprendizado do baseline da vitima", stepLearn);
+    cmd.AddValue("stepSigmas", "adaptiveStep: disparo com |taxa - media| > stepSigmas * desvio", stepSigmas);
+    cmd.AddValue("rewardAttackWeight", "Recompensa: peso dos kB/s de ataque recebidos na vitima", rewardAttackWeight);
+    cmd.AddValue("rewardBenignCost", "Recompensa: custo por no isolado que nao esta atacando", rewardBenignCost);
+    cmd.AddValue("mitigation", "Isolamento: node (desliga as interfaces do no), policer (token bucket por origem nos coordenadores) ou blacklist (descarte no encaminhamento dos coordenadores)", mitigation);
+    cmd.AddValue("policerRate", "mitigation=policer: taxa permitida a um no isolado (0bps = descarta tudo)", policerRate);
+    cmd.AddValue("policerBurst", "mitigation=policer: rajada em bytes do bucket de um no isolado", policerBurst);
+    cmd.AddValue("actionMode", "Acao: binary (a > 0.5 isola) ou rate (o policer deixa passar a * taxa base do no; 1 = sem limite)", actionMode);
+    cmd.AddValue("rateBaseline", "actionMode=rate: taxa base por no (vazio = normalRate)", rateBaseline);
+    cmd.AddValue("rateLevels", "actionMode=rate: niveis em que a acao [0,1] e quantizada", rateLevels);
     cmd.Parse(argc, argv);
     g_tag = tag;
+    if (obsBackend != "flowmon" && obsBackend != "trace") {
+        std::cerr << "obsBackend invalido: " << obsBackend << " (use flowmon ou trace)\n";
+        return 1;
+    }
+    g_traceObs = (obsBackend == "trace");
+    std::string badFeature;
+    if (!ParseTrafficFeatures(obsFeatures, g_obsFeat, badFeature)) {
+        std::cerr << "obsFeatures invalido: '" << badFeature << "'\n";
+        return 1;
+    }
+    if (!ParseObsEncoding(obsEncoding, g_obsEnc)) {
+        std::cerr << "obsEncoding invalido: " << obsEncoding << " (use dense, sparse, quant8 ou quant16)\n";
+        return 1;
+    }
+    if (gymTransport != "zmq" && gymTransport != "shm") {
+        std::cerr << "gymTransport invalido: " << gymTransport << " (use zmq ou shm)\n";
+        return 1;
+    }
+    if (g_stackK < 1 || (g_stackK > 1 && g_obsEnc != OBS_DENSE)) {
+        std::cerr << "stackK invalido: " << g_stackK << " (>= 1; acima de 1 so com obsEncoding=dense)\n";
+        return 1;
+    }
+    if (gymTransport == "shm" && g_obsEnc != OBS_DENSE) {
+        std::cerr << "gymTransport=shm so aceita obsEncoding=dense\n";
+        return 1;
+    }
+    if (gymAsync && (gymTransport != "shm" || decisionLatency < 0.0)) {
+        std::cerr << "gymAsync exige gymTransport=shm e decisionLatency >= 0\n";
+        return 1;
+    }
+    bool usesEwma = std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_EWMA_BYTES) != g_obsFeat.end() ||
+                    std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_EWMA_PKTS) != g_obsFeat.end();
+    if (usesEwma && !ParseHorizons(ewmaHorizons, g_ewmaHorizons)) {
+        std::cerr << "ewmaHorizons invalido: " << ewmaHorizons << "\n";
+        return 1;
+    }
+    // So bytes/s continua no caminho antigo; qualquer outra combinacao sai
+    // das estatisticas por intervalo dos contadores de trace
+    g_featureObs = !(g_obsFeat.size() == 1 && g_obsFeat[0] == FEAT_TX_BYTES);
+    g_nNodes = nMonitored;
+    g_obsStack.Init(g_stackK, g_nNodes * ObservationColumns());
+    std::vector<uint32_t> whitelistIdx;
+    if (aiMode != "gym" && aiMode != "zscore") {
+        std::cerr << "aiMode invalido: " << aiMode << " (use gym ou zscore)\n";
+        return 1;
+    }
+    if (aiMode == "zscore" && g_obsFeat[0] != FEAT_TX_BYTES) {
+        std::cerr << "aiMode=zscore usa a coluna 0 como bytes/s: obsFeatures deve comecar por txBytes\n";
+        return 1;
+    }
+    if (!ParseIndexList(whitelist, whitelistIdx)) {
+        std::cerr << "whitelist invalida: " << whitelist << "\n";
+        return 1;
+    }
+    if (g_adaptiveStep && (aiMode != "gym" || g_stackK > 1 || fineStep <= 0.0 || coarseStep < fineStep)) {
+        std::cerr << "adaptiveStep exige aiMode=gym, stackK=1 e 0 < fineStep <= coarseStep\n";
+        return 1;
+    }
+    g_stepper.Init(coarseStep, fineStep, stepIdle, stepLearn, stepHold, stepSigmas);
+    if (mitigation != "node" && mitigation != "policer" && mitigation != "blacklist") {
+        std::cerr << "mitigation invalida: " << mitigation << " (use node, policer ou blacklist)\n";
+        return 1;
+    }
+    if (mitigation == "blacklist") {   // lista negra = bucket de taxa 0
+        g_policer = Create<SourcePolicerTable>();
+    } else if (mitigation == "policer") {
+        DataRateValue rate;
+        if (!rate.DeserializeFromString(policerRate, MakeDataRateChecker())) {
+            std::cerr << "policerRate invalida: " << policerRate << "\n";
+            return 1;
+        }
+        if (rate.Get().GetBitRate() > 0 && policerBurst == 0) {
+            std::cerr << "policerRate > 0 exige policerBurst >= tamanho de um pacote\n";
+            return 1;
+        }
+        g_policer = Create<SourcePolicerTable>();
+        g_policerRate = rate.Get().GetBitRate();
+        g_policerBurst = policerBurst;
+    }
+    if (actionMode != "binary" && actionMode != "rate") {
+        std::cerr << "actionMode invalido: " << actionMode << " (use binary ou rate)\n";
+        return 1;
+    }
+    if (actionMode == "rate") {
+        DataRateValue base;
+        if (rateBaseline.empty()) rateBaseline = normalRate;
+        if (mitigation != "policer" || policerBurst == 0 || rateLevels < 2 || rateLevels > 1000 ||
+            !base.DeserializeFromString(rateBaseline, MakeDataRateChecker()) || base.Get().GetBitRate() == 0) {
+            std::cerr << "actionMode=rate exige mitigation=policer, policerBurst > 0, rateBaseline > 0 e 2 <= rateLevels <= 1000\n";
+            return 1;
+        }
+        g_rateBaseline = base.Get().GetBitRate();
+        g_actionDelta.SetLevels(rateLevels);
+    }
+    if (!recordFile.empty() && (aiMode != "gym" || g_obsEnc != OBS_DENSE)) {
+        std::cerr << "recordFile exige aiMode=gym e obsEncoding=dense\n";
+        return 1;
+    }
+    if (forkAt > 0.0) {
+        std::string err;
+        if (!ParseBranches(branches, g_branchSpecs, err)) {
+            std::cerr << "branches invalido: " << err << "\n";
+            return 1;
+        }
+        // Socket ZMQ, segmento shm e pcap seriam compartilhados pelos filhos
+        if (aiMode != "zscore" || tracing || forkAt >= 900.0) {
+            std::cerr << "forkAt exige aiMode=zscore, tracing=false e forkAt < 900\n";
+            return 1;
+        }
+    }
+    g_zscore.Init(zIdleSteps, zWarmupSteps, zSigmas);
+    g_policy.Init(g_nNodes, maxIsolations, isolationCooldown, 0.0, maxTotalIsolations);
+    g_policy.SetWhitelist(whitelistIdx);
 
     // (3) Desliga DAD: remove a rajada de Neighbor Solicitation no boot.
     Config::SetDefault("ns3::Icmpv6L4Protocol::DAD", BooleanValue(false));
@@ -248,7 +644,8 @@ int main(int argc, char* argv[])
     const uint32_t K = (nMonitored + nodesPerPan - 1) / nodesPerPan;
     NS_LOG_UNCOND("Topologia: " << nMonitored << " nos em " << K << " PANs de ate "
                   << nodesPerPan << " | normalRate=" << normalRate
-                  << " | attack=" << attack << " | staticNd=" << staticNd);
+                  << " | attack=" << attack << " | staticNd=" << staticNd
+                  << " | obs=" << obsBackend << " [" << obsFeatures << "]");
 
     // ---- Nos ----
     monitoredNodes.Create(nMonitored);
@@ -332,6 +729,8 @@ int main(int argc, char* argv[])
     Ipv6ListRoutingHelper listRh;
     listRh.Add(ipv6StaticRouting, 10);
     listRh.Add(ripNg, 0);
+    if (mitigation == "blacklist")
+        listRh.Add(BlacklistRoutingHelper(g_policer), 100);   // antes do estatico: filtra e passa adiante
 
     InternetStackHelper backboneStack;
     backboneStack.SetRoutingHelper(listRh);
@@ -340,6 +739,21 @@ int main(int argc, char* argv[])
     InternetStackHelper staStack;
     staStack.SetRoutingHelper(ipv6StaticRouting);
     staStack.Install(monitoredNodes);
+    g_actionDelta.Init(monitoredNodes.GetN());
+    g_nodeIpv6.assign(monitoredNodes.GetN(), nullptr);
+    for (uint32_t i = 0; i < monitoredNodes.GetN(); ++i)
+        g_nodeIpv6[i] = monitoredNodes.Get(i)->GetObject<Ipv6>();
+
+    // Policer na saida dos coordenadores para o backbone (antes do Assign,
+    // que instalaria a qdisc padrao)
+    if (mitigation == "policer") {
+        TrafficControlHelper tch;
+        tch.SetRootQueueDisc("ns3::SourcePolicerQueueDisc");
+        for (uint32_t k = 0; k < K; ++k) {
+            QueueDiscContainer qd = tch.Install(csmaDev.Get(k));
+            DynamicCast<SourcePolicerQueueDisc>(qd.Get(0))->SetTable(g_policer);
+        }
+    }
 
     // ---- Enderecamento ----
     Ipv6AddressHelper address;
@@ -394,6 +808,18 @@ int main(int argc, char* argv[])
         if (attackerSet.insert(idx).second) attackerIdx.push_back(idx);
     }
 
+    // Tabela de identidade para o agente: PAN = k + 1; pares atacam na onda 1, impares na 2
+    std::vector<std::string> role(nMonitored, "normal");
+    for (uint32_t j = 0; attack && j < attackerIdx.size(); ++j)
+        role[attackerIdx[j]] = (j % 2 == 0) ? "atk1" : "atk2";
+    g_reward.Init(nMonitored, rewardAttackWeight, rewardBenignCost);
+    g_nodeAddr.assign(nMonitored, Ipv6Address::GetAny());
+    for (uint32_t i = 0; i < nMonitored; ++i) {
+        g_nodeInfo.Add(i, monitoredNodes.Get(i), i / nodesPerPan + 1, role[i]);
+        g_reward.SetRole(i, role[i]);
+        g_nodeAddr[i] = NodeGlobalAddress(monitoredNodes.Get(i));
+    }
+
     // ---- Sinks na vitima ----
     uint16_t normalPort = 9002, attackPort = 9001;
     PacketSinkHelper sinkNormal("ns3::UdpSocketFactory", Inet6SocketAddress(Ipv6Address::GetAny(), normalPort));
@@ -402,6 +828,9 @@ int main(int argc, char* argv[])
     ApplicationContainer s2 = sinkAttack.Install(serverNode.Get(0));
     s1.Start(Seconds(1.0)); s1.Stop(Seconds(900.0));
     s2.Start(Seconds(1.0)); s2.Stop(Seconds(900.0));
+    g_sinkApps.Add(s1);
+    g_sinkApps.Add(s2);
+    g_reward.SetSinks(s1.Get(0), s2.Get(0));
 
     // ---- Trafego NORMAL (taxa parametrizada; on continuo + start aleatorio) ----
     OnOffHelper onoff("ns3::UdpSocketFactory", Address(Inet6SocketAddress(serverAddr, normalPort)));
@@ -432,35 +861,91 @@ int main(int argc, char* argv[])
         onoffAtk.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
         for (uint32_t j = 0; j < attackerIdx.size(); ++j) {
             ApplicationContainer app = onoffAtk.Install(monitoredNodes.Get(attackerIdx[j]));
+            g_attackApps.Add(app);
             if (j % 2 == 0) { app.Start(Seconds(170.0 + (j/2)*0.05)); app.Stop(Seconds(220.0)); }
             else            { app.Start(Seconds(250.0 + (j/2)*0.05)); app.Stop(Seconds(300.0)); }
         }
     }
 
+    for (const BranchSpec &b : g_branchSpecs) {
+        std::string err;
+        if (!ApplyBranch(b, false, err)) {
+            std::cerr << err << "\n";
+            return 1;
+        }
+    }
+
     // ---- FlowMonitor + logging ----
     InstallFlowMonitor();
+    if (g_traceObs || g_featureObs) {
+        bool stampTx = std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_DELAY) != g_obsFeat.end();
+        InstallTrafficCounters(monitoredNodes, serverNode, stampTx, g_ewmaHorizons);
+    }
     Simulator::Schedule(Seconds(899.9), &SaveFlowMonXml);
     g_flowCsv.open("flowmon_persec_system.csv");
     g_flowCsv << "tempo,normal_tx_kbps,normal_rx_kbps,ataque_tx_kbps,ataque_rx_kbps\n";
     Simulator::Schedule(Seconds(1.0), &LogFlowPerSecond);
 
-    uint32_t openGymPort = 5555;
     double envStepTime = 1.0;
-    Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
-    openGym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
-    openGym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
-    openGym->SetGetObservationCb(MakeCallback(&MyGetObservation));
-    openGym->SetGetRewardCb(MakeCallback(&MyGetReward));
-    openGym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
-    openGym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
-    openGym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
-    Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, openGym);
+    Callback<void> notify;
+    if (!recordFile.empty()) g_recorder = CreateObject<GymRecorder>(recordFile);
+    if (aiMode == "zscore") {
+        Simulator::Schedule(Seconds(envStepTime), &ZScoreStep, envStepTime);
+    } else if (gymTransport == "shm") {
+        std::vector<uint32_t> shape = ObservationShape();
+        uint32_t obsCap = 1;
+        for (uint32_t d : shape) obsCap *= d;
+        // Async: observacoes em voo ate a acao chegar = floor(latencia / periodo) + 1
+        double period = (g_adaptiveStep ? fineStep : envStepTime) * g_stackK;
+        uint32_t nSlots = gymAsync ? (uint32_t)std::floor(decisionLatency / period) + 2 : 2;
+        Ptr<ShmGymInterface> shm = CreateObject<ShmGymInterface>(
+            "/ddos_gym_" + std::to_string(openGymPort), obsCap, g_nNodes, 256 + 64 * g_nNodes, nSlots);
+        if (gymAsync) shm->SetAsync(Seconds(decisionLatency));
+        ConnectGym(shm);
+        notify = MakeCallback(&ShmGymInterface::NotifyCurrentState, shm);
+    } else {
+        Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
+        ConnectGym(openGym);
+        notify = MakeCallback(&OpenGymInterface::NotifyCurrentState, openGym);
+    }
+    if (!notify.IsNull()) Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, notify);
+    if (!notify.IsNull() && g_adaptiveStep)
+        Simulator::Schedule(Seconds(fineStep), &AdaptiveStepProbe, envStepTime, notify);
+    if (forkAt > 0.0) {
+        NS_LOG_UNCOND("[FORK] " << g_branchSpecs.size() << " ramos a partir de t=" << forkAt << "s");
+        Simulator::Schedule(Seconds(forkAt), &ForkBranches);
+    }
 
     if (tracing)
         csma.EnablePcap("ddos-server", csmaDev.Get(K), true); // visao agregada na vitima
 
+    g_prof.AddSince(PROF_SETUP, setupT0);
     Simulator::Stop(Seconds(901.0));
     Simulator::Run();
+    if (g_branches.IsParent()) {
+        ReportBranches(g_branchSpecs, g_branches, "normal_tx_bytes,normal_rx_bytes,ataque_tx_bytes,ataque_rx_bytes,isolamentos",
+                       "fork_results_" + tag + ".csv");
+        g_flowCsv.close();
+        Simulator::Destroy();
+        return 0;
+    }
+    g_prof.Report(std::cout, g_nNodes);
+    if (aiMode == "zscore")
+        std::cout << "[ZSCORE] isolamentos no total: " << g_policy.GetTotalIsolations() << "\n";
+    std::cout << "[REWARD] " << g_reward.Summary() << "\n";
+    if (g_policer)
+        std::cout << (mitigation == "blacklist" ? "[BLACKLIST] " : "[POLICER] ") << g_policer->GetNDropped()
+                  << " pacotes (" << g_policer->GetDroppedBytes() << " bytes) barrados no 1o salto, "
+                  << g_policer->GetNPassed() << " passaram\n";
+    if (g_branches.IsChild()) g_branches.Report(BranchSummary());
+    if (g_adaptiveStep)
+        std::cout << "[STEP] " << g_stepTick << " leituras do agente, " << g_stepper.GetNFires()
+                  << " disparos (baseline da vitima " << g_stepper.GetMean() << " +- " << g_stepper.GetStd() << " B/s)\n";
+    if (g_recorder) {
+        g_recorder->Close();
+        std::cout << "[INFO] Gravacao: " << g_recorder->GetNStates() << " estados, "
+                  << g_recorder->GetNActions() << " acoes em " << recordFile << "\n";
+    }
 
     g_flowCsv.close();
 
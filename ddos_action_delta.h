@@ -0,0 +1,92 @@
+// =============================================================================
+//  Acao por diferenca para o MyExecuteActions
+//
+//  O cenario guarda a ultima decisao por no e so toca (interfaces, OnOff) os
+//  nos cuja decisao mudou; o resto do vetor custa uma comparacao por no. Com
+//  poucos isolamentos por passo sao poucas chamadas ao ns-3 em vez de N.
+//
+//  Formatos de acao aceitos (a > 0.5 = isolar):
+//    denso:    [a_0, a_1, ..., a_{N-1}]
+//    esparso:  [-1, i_0, a_0, i_1, a_1, ...]   so os indices que mudaram
+//  O esparso e o que o agent_isolation.py manda com --delta-actions quando
+//  fica menor que o denso.
+//
+//  Com SetLevels(L > 1) (--actionMode=rate) a acao e graduada: a e a fracao
+//  da taxa base do no que o gateway deixa passar (1 = sem limite, 0 = nada),
+//  quantizada em L niveis. So mudancas de nivel contam, entao ruido pequeno
+//  do agente nao reinicia o bucket a cada passo. IsIsolated vale como "passa
+//  menos da metade" para a recompensa e os contadores.
+// =============================================================================
+#ifndef DDOS_ACTION_DELTA_H
+#define DDOS_ACTION_DELTA_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+class ActionDelta
+{
+  public:
+    void Init(uint32_t nNodes)
+    {
+        m_level.assign(nNodes, 0);
+        m_nIsolated = 0;
+    }
+
+    // 1 = binario (a > 0.5 isola); L > 1 = a e a fracao liberada, em L niveis
+    void SetLevels(uint16_t levels) { m_levels = levels < 1 ? 1 : levels; }
+
+    // Atualiza a decisao por no e devolve os indices que mudaram (o estado
+    // novo de cada um em IsIsolated / GetAllowed)
+    const std::vector<uint32_t> &Update(const std::vector<float> &action)
+    {
+        m_changed.clear();
+        if (!action.empty() && action[0] < 0.0f) {
+            for (size_t k = 1; k + 1 < action.size(); k += 2)
+                if (action[k] >= 0.0f) Set((uint32_t)action[k], Level(action[k + 1]));
+        } else {
+            for (uint32_t i = 0; i < action.size() && i < m_level.size(); ++i)
+                Set(i, Level(action[i]));
+        }
+        return m_changed;
+    }
+
+    bool IsIsolated(uint32_t i) const { return i < m_level.size() && Isolating(m_level[i]); }
+    uint32_t GetNIsolated() const { return m_nIsolated; }
+
+    // Fracao da taxa base do no que passa (1 = livre, 0 = isolado)
+    double GetAllowed(uint32_t i) const { return i < m_level.size() ? 1.0 - (double)m_level[i] / m_levels : 1.0; }
+
+  private:
+    uint16_t Level(float a) const
+    {
+        if (m_levels == 1) return a > 0.5f;
+        a = std::min(1.0f, std::max(0.0f, a));
+        return (uint16_t)std::lround((1.0f - a) * m_levels);   // nivel = quanto e cortado
+    }
+
+    bool Isolating(uint16_t level) const { return 2 * level > m_levels; }
+
+    void Set(uint32_t i, uint16_t level)
+    {
+        if (i >= m_level.size() || m_level[i] == level) return;
+        bool was = Isolating(m_level[i]);
+        m_level[i] = level;
+        if (Isolating(level) != was) m_nIsolated += was ? -1 : 1;
+        m_changed.push_back(i);
+    }
+
+    std::vector<uint16_t> m_level;   // 0 = livre, m_levels = isolado
+    std::vector<uint32_t> m_changed;
+    uint16_t m_levels{1};
+    uint32_t m_nIsolated{0};
+};
+
+} // namespace ns3
+
+#endif // DDOS_ACTION_DELTA_H
@@ -0,0 +1,100 @@
+// =============================================================================
+//  Passo adaptativo do OpenGym (--adaptiveStep)
+//
+//  Com envStepTime fixo o agente e chamado 900 vezes por episodio, embora o
+//  ataque so exista entre 170 e 300 s. Aqui o passo e grosso (coarseStep,
+//  ex. 10 s) enquanto a taxa recebida na vitima fica dentro do envelope do
+//  baseline e cai para fineStep (ex. 0.5 s) quando um detector de mudanca
+//  dispara; volta ao grosso holdTime segundos depois do ultimo disparo.
+//
+//  O detector nao depende do passo do agente: o cenario chama Probe() a cada
+//  fineStep com o total de bytes recebidos pelos sinks da vitima (custo de
+//  duas leituras de contador, sem round trip). A taxa de cada sonda entra
+//  num baseline Welford entre idleTime e idleTime + learnTime; depois, um
+//  desvio acima de max(sigmas * desvio, 5% da media) e um disparo. Se ele
+//  acontece no meio de um passo grosso, o cenario antecipa a leitura.
+//
+//  O info de cada estado leva step=<s> (intervalo coberto pela observacao);
+//  as observacoes continuam em taxa por segundo, medidas sobre esse mesmo
+//  intervalo (o FlowIntervalSampler guarda uma linha de base para a
+//  observacao e outra para o CSV por segundo, que segue de 1 em 1 s).
+//  Contagens em passos do agente (ex. warmup) passam a valer passos de
+//  duracao variavel.
+// =============================================================================
+#ifndef DDOS_ADAPTIVE_STEP_H
+#define DDOS_ADAPTIVE_STEP_H
+
+#include "ddos_native_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace ns3
+{
+
+class AdaptiveStepper
+{
+  public:
+    void Init(double coarseStep, double fineStep, double idleTime, double learnTime, double holdTime,
+              double sigmas)
+    {
+        m_coarse = coarseStep;
+        m_fine = fineStep;
+        m_idle = idleTime;
+        m_learn = learnTime;
+        m_hold = holdTime;
+        m_sigmas = sigmas;
+        m_stats = RunningStats();
+        m_lastT = -1.0;
+        m_fineUntil = -1.0;
+        m_nFires = 0;
+    }
+
+    // 'rxBytes' = total acumulado recebido na vitima em 'now'. true quando o
+    // detector dispara com o passo grosso em vigor (antecipar a leitura)
+    bool Probe(double now, uint64_t rxBytes)
+    {
+        double dt = now - m_lastT;
+        bool first = m_lastT < 0.0;
+        double rate = first || dt <= 0.0 ? 0.0 : (double)(rxBytes - m_lastRx) / dt;
+        m_lastT = now;
+        m_lastRx = rxBytes;
+        if (first || dt <= 0.0 || now <= m_idle) return false;
+        if (now <= m_idle + m_learn) {
+            m_stats.Add(rate);
+            return false;
+        }
+        double limit = std::max(m_sigmas * m_stats.Std(), 0.05 * m_stats.Mean());
+        if (std::abs(rate - m_stats.Mean()) <= limit) return false;
+        bool wasCoarse = now >= m_fineUntil;
+        m_fineUntil = now + m_hold;
+        m_nFires++;
+        return wasCoarse;
+    }
+
+    // Duracao do proximo passo do agente a partir de 'now'
+    double StepAt(double now) const { return now < m_fineUntil ? m_fine : m_coarse; }
+
+    double GetFineStep() const { return m_fine; }
+    uint64_t GetNFires() const { return m_nFires; }
+    double GetMean() const { return m_stats.Mean(); }
+    double GetStd() const { return m_stats.Std(); }
+
+  private:
+    double m_coarse{10.0};
+    double m_fine{0.5};
+    double m_idle{15.0};
+    double m_learn{60.0};
+    double m_hold{20.0};
+    double m_sigmas{4.0};
+    RunningStats m_stats;
+    double m_lastT{-1.0};
+    uint64_t m_lastRx{0};
+    double m_fineUntil{-1.0};
+    uint64_t m_nFires{0};
+};
+
+} // namespace ns3
+
+#endif // DDOS_ADAPTIVE_STEP_H
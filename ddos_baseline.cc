@@ -57,13 +57,9 @@ main(int argc, char* argv[])
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Tell echo applications to log if true", verbose);
     cmd.AddValue("tracing", "Enable pcap tracing", tracing);
+    cmd.AddValue("nWifi", "STAs por rede WiFi", nWifi);
     cmd.Parse(argc, argv);
-
-    if (nWifi > 200) 
-    {
-        std::cout << "nWifi muito grande; ajuste o script ou aumente a área." << std::endl;
-        return 1;
-    }
+    nWifiCsma = nWifi; // a rede 3 é criada com nWifi nós
 
     // Criação dos Nós STA
     wifiStaNodes1.Create(nWifi);
@@ -128,6 +124,9 @@ main(int argc, char* argv[])
     MobilityHelper mobility;
     double spacing = 5.0;    
     double offsetCell = 75.0; 
+    // Com muitos nós a grade passa de 75 m: afasta as células para não sobrepor
+    uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(std::max(nWifi, nWifiCsma)))));
+    offsetCell = std::max(offsetCell, gridSide * spacing + 25.0);
 
     Ptr<ListPositionAllocator> allocWifi1 = CreateGridPositionAllocator (nWifi, spacing, 0.0, 0.0);
     Ptr<ListPositionAllocator> allocWifi2 = CreateGridPositionAllocator (nWifi, spacing, 0.0, offsetCell);    
@@ -0,0 +1,105 @@
+// =============================================================================
+//  Lista negra no encaminhamento dos coordenadores (--mitigation=blacklist)
+//
+//  Um Ipv6RoutingProtocol que nao roteia nada: entra no Ipv6ListRouting dos
+//  coordenadores com prioridade acima do estatico e, no RouteInput, consome
+//  (descarta) os pacotes encaminhados cuja origem esta na lista negra; os
+//  demais seguem para o proximo protocolo da lista. Entrega local (ND, ping
+//  para o proprio coordenador) nao passa por aqui.
+//
+//  A lista e a mesma tabela de enderecamento aberto do policer
+//  (ddos_source_policer.h) com taxa 0: uma consulta O(1) por pacote e
+//  contadores de pacotes/bytes barrados, que e o trafego poupado ao backbone
+//  CSMA e a vitima.
+// =============================================================================
+#ifndef DDOS_BLACKLIST_ROUTING_H
+#define DDOS_BLACKLIST_ROUTING_H
+
+#include "ddos_source_policer.h"
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+namespace ns3
+{
+
+class BlacklistRouting : public Ipv6RoutingProtocol
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::BlacklistRouting")
+                                .SetParent<Ipv6RoutingProtocol>()
+                                .SetGroupName("Internet")
+                                .AddConstructor<BlacklistRouting>();
+        return tid;
+    }
+
+    void SetTable(Ptr<SourcePolicerTable> table) { m_table = table; }
+
+    // Nunca origina rotas: o proximo protocolo da lista responde
+    Ptr<Ipv6Route> RouteOutput(Ptr<Packet> p, const Ipv6Header &header, Ptr<NetDevice> oif,
+                               Socket::SocketErrno &sockerr) override
+    {
+        sockerr = Socket::ERROR_NOROUTETOHOST;
+        return nullptr;
+    }
+
+    bool RouteInput(Ptr<const Packet> p, const Ipv6Header &header, Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback &ucb, const MulticastForwardCallback &mcb,
+                    const LocalDeliverCallback &lcb, const ErrorCallback &ecb) override
+    {
+        // true = consumido: o pacote para aqui, sem ICMP de volta pelo radio
+        return m_table && !m_table->Conform(header.GetSource(), p->GetSize() + header.GetSerializedSize());
+    }
+
+    void NotifyInterfaceUp(uint32_t interface) override {}
+    void NotifyInterfaceDown(uint32_t interface) override {}
+    void NotifyAddAddress(uint32_t interface, Ipv6InterfaceAddress address) override {}
+    void NotifyRemoveAddress(uint32_t interface, Ipv6InterfaceAddress address) override {}
+    void NotifyAddRoute(Ipv6Address dst, Ipv6Prefix mask, Ipv6Address nextHop, uint32_t interface,
+                        Ipv6Address prefixToUse = Ipv6Address::GetZero()) override
+    {
+    }
+    void NotifyRemoveRoute(Ipv6Address dst, Ipv6Prefix mask, Ipv6Address nextHop, uint32_t interface,
+                           Ipv6Address prefixToUse = Ipv6Address::GetZero()) override
+    {
+    }
+    void SetIpv6(Ptr<Ipv6> ipv6) override {}
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override
+    {
+        *stream->GetStream() << "BlacklistRouting: filtro por origem, sem rotas\n";
+    }
+
+  private:
+    Ptr<SourcePolicerTable> m_table;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BlacklistRouting);
+
+// Para o Ipv6ListRoutingHelper: todos os nos recebem a mesma tabela
+class BlacklistRoutingHelper : public Ipv6RoutingHelper
+{
+  public:
+    explicit BlacklistRoutingHelper(Ptr<SourcePolicerTable> table)
+        : m_table(table)
+    {
+    }
+
+    BlacklistRoutingHelper *Copy() const override { return new BlacklistRoutingHelper(m_table); }
+
+    Ptr<Ipv6RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        Ptr<BlacklistRouting> r = CreateObject<BlacklistRouting>();
+        r->SetTable(m_table);
+        return r;
+    }
+
+  private:
+    Ptr<SourcePolicerTable> m_table;
+};
+
+} // namespace ns3
+
+#endif // DDOS_BLACKLIST_ROUTING_H
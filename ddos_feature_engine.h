@@ -0,0 +1,103 @@
+// =============================================================================
+//  Motor de features com memoria: taxas EWMA por no em varios horizontes
+//
+//  Cada no guarda, para cada horizonte tau (ex.: 1 s, 5 s, 30 s), uma "massa"
+//  de bytes e de pacotes que decai como exp(-dt/tau). A atualizacao acontece
+//  no proprio evento de pacote (O(H) por pacote, sem timers) e a leitura so
+//  aplica o decaimento ate o instante atual, sem alterar o estado:
+//
+//      S <- S * exp(-(t - t_ult) / tau) + bytes       (no pacote)
+//      taxa(t) = S * exp(-(t - t_ult) / tau) / tau    (na leitura, bytes/s)
+//
+//  O estado fica em vetores planos, no-major (os H horizontes de um no sao
+//  vizinhos na memoria), entao um pacote toca uma unica linha de cache.
+//  Com isso o historico fica dentro do ns-3 e o agente pode ser sem estado.
+// =============================================================================
+#ifndef DDOS_FEATURE_ENGINE_H
+#define DDOS_FEATURE_ENGINE_H
+
+#include "ns3/core-module.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class RateEwmaEngine
+{
+  public:
+    void Init(uint32_t nNodes, const std::vector<double> &horizonsS)
+    {
+        m_n = nNodes;
+        m_h = horizonsS.size();
+        m_tauS = horizonsS;
+        m_lastTs.assign(m_n, 0);
+        m_bytes.assign((size_t)m_n * m_h, 0.0);
+        m_pkts.assign((size_t)m_n * m_h, 0.0);
+    }
+
+    bool IsEnabled() const { return m_h > 0; }
+    uint32_t GetNHorizons() const { return m_h; }
+
+    void OnPacket(uint32_t idx, int64_t nowTs, uint32_t bytes)
+    {
+        double dt = TimeStep(nowTs - m_lastTs[idx]).GetSeconds();
+        m_lastTs[idx] = nowTs;
+        double *b = &m_bytes[(size_t)idx * m_h];
+        double *p = &m_pkts[(size_t)idx * m_h];
+        for (uint32_t h = 0; h < m_h; ++h) {
+            double k = std::exp(-dt / m_tauS[h]);
+            b[h] = b[h] * k + bytes;
+            p[h] = p[h] * k + 1.0;
+        }
+    }
+
+    // Taxa do no 'idx' no horizonte 'h' decaida ate nowTs (bytes/s ou pkt/s)
+    double ByteRate(uint32_t idx, uint32_t h, int64_t nowTs) const
+    {
+        return Decayed(m_bytes, idx, h, nowTs);
+    }
+    double PktRate(uint32_t idx, uint32_t h, int64_t nowTs) const
+    {
+        return Decayed(m_pkts, idx, h, nowTs);
+    }
+
+  private:
+    double Decayed(const std::vector<double> &v, uint32_t idx, uint32_t h, int64_t nowTs) const
+    {
+        double dt = TimeStep(nowTs - m_lastTs[idx]).GetSeconds();
+        return v[(size_t)idx * m_h + h] * std::exp(-dt / m_tauS[h]) / m_tauS[h];
+    }
+
+    uint32_t m_n{0};
+    uint32_t m_h{0};
+    std::vector<double> m_tauS;     // horizontes (s)
+    std::vector<int64_t> m_lastTs;  // ticks do ultimo pacote de cada no
+    std::vector<double> m_bytes;    // [no * H + h]
+    std::vector<double> m_pkts;     // [no * H + h]
+};
+
+// "1,5,30" -> {1.0, 5.0, 30.0}; retorna false se algum valor nao for um
+// numero > 0 (lixo no fim, como "5x", tambem e rejeitado)
+static bool ParseHorizons(const std::string &csv, std::vector<double> &out)
+{
+    out.clear();
+    std::stringstream ss(csv);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        if (tok.empty()) continue;
+        char *end = nullptr;
+        double v = std::strtod(tok.c_str(), &end);
+        if (*end != '\0' || !(v > 0.0)) return false;
+        out.push_back(v);
+    }
+    return !out.empty();
+}
+
+} // namespace ns3
+
+#endif // DDOS_FEATURE_ENGINE_H
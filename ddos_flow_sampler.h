@@ -0,0 +1,186 @@
+// =============================================================================
+//  Amostrador de FlowStats por intervalo
+//
+//  Uma unica fotografia do FlowMonitor por instante de simulacao: a primeira
+//  chamada de Snapshot() num dado Now() faz CheckForLostPackets() e percorre
+//  GetFlowStats(); chamadas seguintes no mesmo instante (log CSV, observacao
+//  do agente, relatorio final) reaproveitam os acumulados, entao o custo nao
+//  se repete para cada consumidor.
+//
+//  Os deltas sao por consumidor: Sample(FLOW_CSV) mede desde a ultima linha
+//  do CSV e Sample(FLOW_OBS) desde a ultima observacao, cada um com a sua
+//  linha de base. Com passos do agente diferentes de 1 s (--adaptiveStep,
+//  --stepTime) um nao encurta o intervalo do outro: o CSV continua por
+//  segundo e a observacao cobre [leitura anterior, agora].
+//
+//  Cada fluxo e classificado uma so vez (FindFlow na primeira aparicao): no de
+//  origem em 'nodes' e porta de destino ficam guardados junto dos contadores.
+//
+//  Uso:
+//    g_flowSampler.Install(flowMonitor, ipv6Classifier, monitoredNodes);
+//    g_flowSampler.Sample(FLOW_OBS);               // idempotente por instante
+//    for (const auto &f : g_flowSampler.Flows()) ...   // deltas do FLOW_OBS
+//    const std::vector<float> &tp = g_flowSampler.NodeTxRates();
+//    g_flowSampler.Snapshot();                     // so os acumulados
+// =============================================================================
+#ifndef DDOS_FLOW_SAMPLER_H
+#define DDOS_FLOW_SAMPLER_H
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv6-flow-classifier.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+static const int32_t FLOW_UNCLASSIFIED = -2;   // fluxo ainda nao visto
+static const int32_t FLOW_UNMONITORED  = -1;   // origem fora dos nos monitorados
+
+// Quem le os deltas: cada um tem a sua linha de base
+enum FlowConsumer
+{
+    FLOW_CSV = 0,   // log por segundo
+    FLOW_OBS,       // observacao do agente / detector nativo
+    FLOW_N_CONSUMERS
+};
+
+class FlowIntervalSampler
+{
+  public:
+    struct Flow
+    {
+        int32_t node{FLOW_UNCLASSIFIED};   // indice do no de origem (ou FLOW_*)
+        uint16_t dstPort{0};
+        uint64_t txBytes{0}, rxBytes{0};   // acumulado ate a ultima fotografia
+        uint64_t txPkts{0}, rxPkts{0};
+        uint64_t dTxBytes{0}, dRxBytes{0}; // delta do consumidor do ultimo Sample()
+        uint64_t dTxPkts{0}, dRxPkts{0};
+    };
+
+    void Install(Ptr<FlowMonitor> mon, Ptr<Ipv6FlowClassifier> cls, const NodeContainer &nodes)
+    {
+        m_mon = mon;
+        m_cls = cls;
+        m_flows.clear();
+        m_addrToNode.clear();
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            Ptr<Ipv6> ipv6 = nodes.Get(i)->GetObject<Ipv6>();
+            if (!ipv6) continue;
+            for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
+                if (ipv6->GetNAddresses(ifIdx) < 2) continue;   // so link-local
+                m_addrToNode[ipv6->GetAddress(ifIdx, 1).GetAddress()] = i;
+            }
+        }
+        m_nodeTp.assign(nodes.GetN(), 0.0f);
+        m_lastTs = -1;
+        for (View &v : m_views) v = View();
+        m_interval = 0.0;
+    }
+
+    bool IsReady() const { return m_mon && m_cls; }
+
+    // Fotografa o FlowMonitor no instante atual (no maximo uma vez por Now());
+    // atualiza so os acumulados
+    void Snapshot()
+    {
+        if (!IsReady()) return;
+        int64_t now = Simulator::Now().GetTimeStep();
+        if (now == m_lastTs) return;
+        m_lastTs = now;
+
+        m_mon->CheckForLostPackets();
+        const FlowMonitor::FlowStatsContainer &stats = m_mon->GetFlowStats();
+        for (auto &kv : stats) {
+            Flow &f = Classify(kv.first);
+            const FlowMonitor::FlowStats &fs = kv.second;
+            f.txBytes = fs.txBytes;     f.rxBytes = fs.rxBytes;
+            f.txPkts  = fs.txPackets;   f.rxPkts  = fs.rxPackets;
+        }
+    }
+
+    // Deltas de 'c' desde a amostra anterior dele (a primeira mede desde t=0);
+    // repetir no mesmo instante devolve o mesmo intervalo
+    void Sample(FlowConsumer c)
+    {
+        if (!IsReady()) return;
+        Snapshot();
+        View &v = m_views[c];
+        if (v.endTs != m_lastTs) {
+            v.start.swap(v.end);
+            v.startTs = v.endTs < 0 ? 0 : v.endTs;
+            v.endTs = m_lastTs;
+            v.end.resize(m_flows.size());
+            for (size_t k = 0; k < m_flows.size(); ++k)
+                v.end[k] = {m_flows[k].txBytes, m_flows[k].rxBytes, m_flows[k].txPkts, m_flows[k].rxPkts};
+        }
+        v.start.resize(m_flows.size());   // fluxos novos partem de zero
+        for (size_t k = 0; k < m_flows.size(); ++k) {
+            Flow &f = m_flows[k];
+            f.dTxBytes = v.end[k].txBytes - v.start[k].txBytes;
+            f.dRxBytes = v.end[k].rxBytes - v.start[k].rxBytes;
+            f.dTxPkts  = v.end[k].txPkts - v.start[k].txPkts;
+            f.dRxPkts  = v.end[k].rxPkts - v.start[k].rxPkts;
+        }
+
+        m_interval = TimeStep(v.endTs - v.startTs).GetSeconds();
+        std::fill(m_nodeTp.begin(), m_nodeTp.end(), 0.0f);
+        if (m_interval <= 0.0) return;
+        for (const Flow &f : m_flows) {
+            if (f.node >= 0) m_nodeTp[f.node] += (float)((double)f.dTxBytes / m_interval);
+        }
+    }
+
+    // Fluxos indexados por FlowId (posicoes nunca vistas ficam com node < 0)
+    const std::vector<Flow> &Flows() const { return m_flows; }
+    // Bytes/s enviados por no monitorado no intervalo do ultimo Sample()
+    const std::vector<float> &NodeTxRates() const { return m_nodeTp; }
+    // Duracao (s) do intervalo do ultimo Sample()
+    double GetInterval() const { return m_interval; }
+
+  private:
+    struct Counters
+    {
+        uint64_t txBytes{0}, rxBytes{0}, txPkts{0}, rxPkts{0};
+    };
+
+    // Linha de base de um consumidor: acumulados no inicio e no fim do intervalo
+    struct View
+    {
+        int64_t startTs{0};
+        int64_t endTs{-1};             // -1: nenhuma amostra ainda
+        std::vector<Counters> start;   // [flowId]
+        std::vector<Counters> end;
+    };
+
+    Flow &Classify(FlowId fid)
+    {
+        if (fid >= m_flows.size()) m_flows.resize(fid + 1);
+        Flow &f = m_flows[fid];
+        if (f.node == FLOW_UNCLASSIFIED) {
+            Ipv6FlowClassifier::FiveTuple t = m_cls->FindFlow(fid);
+            auto it = m_addrToNode.find(t.sourceAddress);
+            f.node = (it != m_addrToNode.end()) ? (int32_t)it->second : FLOW_UNMONITORED;
+            f.dstPort = t.destinationPort;
+        }
+        return f;
+    }
+
+    Ptr<FlowMonitor> m_mon;
+    Ptr<Ipv6FlowClassifier> m_cls;
+    std::unordered_map<Ipv6Address, uint32_t, Ipv6AddressHash> m_addrToNode;
+    std::vector<Flow> m_flows;     // [flowId]
+    std::vector<float> m_nodeTp;   // [no]
+    int64_t m_lastTs{-1};          // ticks da ultima fotografia (-1: nenhuma)
+    View m_views[FLOW_N_CONSUMERS];
+    double m_interval{0.0};        // s cobertos pelo ultimo Sample()
+};
+
+} // namespace ns3
+
+#endif // DDOS_FLOW_SAMPLER_H
@@ -0,0 +1,210 @@
+// =============================================================================
+//  Ramos a partir de um estado aquecido (--forkAt / --branches)
+//
+//  A rede roda uma unica vez ate forkAt (boot, ND, trafego benigno, warmup
+//  do detector) e ai o processo faz fork() de um filho por ramo. Cada filho
+//  herda a memoria inteira do simulador (fila de eventos, RNG, pilhas,
+//  FlowMonitor), aplica os parametros do seu ramo e segue ate o fim; o pai
+//  fica parado no instante do fork, espera os filhos e junta os resumos.
+//
+//  Formato de --branches (ramos separados por ';', parametros por ','):
+//    semAtaque:attackRate=0;forte:attackRate=10Mbps,maxIsolations=10
+//  O nome e opcional ("b<i>" se faltar) e vira sufixo dos arquivos do filho.
+//
+//  Limites: descritores abertos sao compartilhados com os filhos, entao o
+//  OpenGym (socket ZMQ ou segmento shm) e o pcap nao podem estar ativos, e
+//  os streams em buffer precisam de flush antes do fork.
+// =============================================================================
+#ifndef DDOS_FORK_BRANCH_H
+#define DDOS_FORK_BRANCH_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+struct BranchSpec
+{
+    std::string name;
+    std::map<std::string, std::string> params;
+};
+
+// false (com 'err') se algum ramo ou par chave=valor estiver mal formado
+static bool ParseBranches(const std::string &spec, std::vector<BranchSpec> &out, std::string &err)
+{
+    out.clear();
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        if (item.empty()) continue;
+        BranchSpec b;
+        size_t colon = item.find(':');
+        b.name = colon == std::string::npos ? "b" + std::to_string(out.size()) : item.substr(0, colon);
+        if (b.name.empty() || b.name.find_first_of("/ ") != std::string::npos) {
+            err = "nome de ramo invalido: '" + b.name + "'";
+            return false;
+        }
+        std::stringstream ps(colon == std::string::npos ? item : item.substr(colon + 1));
+        std::string kv;
+        while (std::getline(ps, kv, ',')) {
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                err = "parametro sem chave=valor no ramo " + b.name + ": '" + kv + "'";
+                return false;
+            }
+            b.params[kv.substr(0, eq)] = kv.substr(eq + 1);
+        }
+        out.push_back(b);
+    }
+    if (out.empty()) err = "nenhum ramo";
+    return !out.empty();
+}
+
+// Copia 'from' para 'to' e reabre 'out' em 'to' (append): o filho fica com o
+// historico ate o fork e escreve o resto no seu proprio arquivo
+static bool BranchCopyOutput(std::ofstream &out, const std::string &from, const std::string &to)
+{
+    out.close();
+    {
+        std::ifstream in(from, std::ios::binary);
+        std::ofstream dst(to, std::ios::binary | std::ios::trunc);
+        if (!in || !dst) return false;
+        dst << in.rdbuf();
+    }
+    out.open(to, std::ios::app);
+    return out.good();
+}
+
+class BranchRunner
+{
+  public:
+    // No pai: um filho por ramo (no maximo maxJobs vivos; 0 = todos de uma
+    // vez), espera todos e devolve -1. No filho: devolve o indice do ramo.
+    int Fork(uint32_t nBranches, uint32_t maxJobs)
+    {
+        m_forked = true;
+        m_results.assign(nBranches, std::string());
+        m_status.assign(nBranches, -1);
+        std::map<pid_t, std::pair<uint32_t, int>> running;   // pid -> (ramo, leitura do pipe)
+        for (uint32_t b = 0; b < nBranches; ++b) {
+            while (maxJobs > 0 && running.size() >= maxJobs) Reap(running);
+            int fd[2];
+            if (pipe(fd) != 0) {
+                std::cerr << "[FORK] pipe: " << std::strerror(errno) << "\n";
+                continue;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(fd[0]);
+                for (auto &r : running) close(r.second.second);
+                m_child = true;
+                m_branch = b;
+                m_out = fd[1];
+                return (int)b;
+            }
+            close(fd[1]);
+            if (pid < 0) {
+                std::cerr << "[FORK] fork do ramo " << b << ": " << std::strerror(errno) << "\n";
+                close(fd[0]);
+                continue;
+            }
+            running[pid] = {b, fd[0]};
+        }
+        while (!running.empty()) Reap(running);
+        return -1;
+    }
+
+    bool IsChild() const { return m_child; }
+    bool IsParent() const { return m_forked && !m_child; }
+    uint32_t GetBranch() const { return m_branch; }
+
+    // Filho: linha de resumo entregue ao pai (uma vez, no fim da simulacao)
+    void Report(const std::string &line)
+    {
+        if (m_out < 0) return;
+        std::string s = line + "\n";
+        for (size_t off = 0; off < s.size();) {
+            ssize_t n = write(m_out, s.data() + off, s.size() - off);
+            if (n <= 0 && errno != EINTR) break;
+            if (n > 0) off += n;
+        }
+        close(m_out);
+        m_out = -1;
+    }
+
+    // Pai: resumo de cada ramo ("" se o filho morreu antes do Report) e o
+    // status de saida (-1 se nem chegou a rodar)
+    const std::vector<std::string> &GetResults() const { return m_results; }
+    const std::vector<int> &GetStatus() const { return m_status; }
+
+  private:
+    void Reap(std::map<pid_t, std::pair<uint32_t, int>> &running)
+    {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) return;
+            for (auto &r : running) close(r.second.second);   // sem filhos: nada mais a esperar
+            running.clear();
+            return;
+        }
+        auto it = running.find(pid);
+        if (it == running.end()) return;
+        uint32_t b = it->second.first;
+        int fd = it->second.second;
+        // O resumo cabe no buffer do pipe: da para ler depois do waitpid
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) m_results[b].append(buf, n);
+        close(fd);
+        while (!m_results[b].empty() && m_results[b].back() == '\n') m_results[b].pop_back();
+        m_status[b] = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        running.erase(it);
+    }
+
+    bool m_forked{false};
+    bool m_child{false};
+    uint32_t m_branch{0};
+    int m_out{-1};
+    std::vector<std::string> m_results;
+    std::vector<int> m_status;
+};
+
+// Pai: uma linha por ramo no terminal e em 'csvPath'. 'columns' e o
+// cabecalho do resumo que cada filho manda no Report()
+static void ReportBranches(const std::vector<BranchSpec> &specs, const BranchRunner &runner,
+                           const std::string &columns, const std::string &csvPath)
+{
+    std::ofstream csv(csvPath);
+    csv << "ramo,parametros,status," << columns << "\n";
+    std::cout << "\n=== RAMOS (" << columns << ") ===\n";
+    for (uint32_t b = 0; b < specs.size(); ++b) {
+        std::string params;
+        for (const auto &kv : specs[b].params)
+            params += (params.empty() ? "" : " ") + kv.first + "=" + kv.second;
+        const std::string &res = runner.GetResults()[b];
+        int status = runner.GetStatus()[b];
+        std::cout << specs[b].name << " [" << params << "] status=" << status << ": "
+                  << (res.empty() ? "sem resumo" : res) << "\n";
+        csv << specs[b].name << "," << params << "," << status << "," << res << "\n";
+    }
+    std::cout << "[INFO] Resumo dos ramos: " << csvPath << "\n";
+}
+
+} // namespace ns3
+
+#endif // DDOS_FORK_BRANCH_H
@@ -0,0 +1,201 @@
+// =============================================================================
+//  Gravacao da interacao com o agente (--recordFile) para o replay_env.py
+//
+//  Fica entre o transporte (ZMQ ou shm) e os callbacks do cenario: cada
+//  estado entregue ao agente (observacao densa, reward, gameOver, info) e
+//  cada acao aplicada vao para um arquivo binario compacto, na ordem em que
+//  acontecem. Depois o replay_env.py serve esses passos ao agent_isolation.py
+//  pela mesma API de gym, sem simulador: da para trocar limiar ou modelo e
+//  rodar de novo em segundos.
+//
+//  O replay e em malha aberta: as observacoes sao as da execucao gravada,
+//  qualquer que seja a acao do agente agora.
+//
+//  Formato (ordem de bytes da maquina, little-endian no x86):
+//    cabecalho  "DDOSREC1" (8)  versao u32  reservado u32
+//    registro 'S' (estado)
+//      tipo u8  t f64  reward f32  gameOver u8  nDims u8  shape[nDims] u32
+//      obs[prod(shape)] f32  infoLen u32  info[infoLen]
+//    registro 'A' (acao aplicada)
+//      tipo u8  t f64  n u32  acao[n] f32
+//
+//  Uso:
+//    g_recorder = CreateObject<GymRecorder>("run.ddrec");
+//    g_recorder->Attach(gym, MakeCallback(&MyGetObservation), ...);   // no ConnectGym
+//    g_recorder->Close();                                             // depois do Run
+//
+//  So o modo de observacao denso (OpenGymBoxContainer<float>) e gravado.
+// =============================================================================
+#ifndef DDOS_GYM_RECORDER_H
+#define DDOS_GYM_RECORDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/opengym-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class GymRecorder : public Object
+{
+  public:
+    static const uint32_t VERSION = 1;
+
+    explicit GymRecorder(const std::string &path)
+        : m_out(path, std::ios::binary | std::ios::trunc)
+    {
+        NS_ABORT_MSG_IF(!m_out, "nao foi possivel criar " << path);
+        m_out.write("DDOSREC1", 8);
+        Put<uint32_t>(VERSION);
+        Put<uint32_t>(0);
+    }
+
+    ~GymRecorder() override { Close(); }
+
+    // Troca os callbacks de estado/acao do transporte pelos da gravacao, que
+    // chamam os originais e registram o resultado
+    template <class Gym>
+    void Attach(Ptr<Gym> gym, Callback<Ptr<OpenGymDataContainer>> obs, Callback<float> reward,
+                Callback<bool> gameOver, Callback<std::string> info,
+                Callback<bool, Ptr<OpenGymDataContainer>> act)
+    {
+        m_obsCb = obs;
+        m_rewardCb = reward;
+        m_gameOverCb = gameOver;
+        m_infoCb = info;
+        m_actCb = act;
+        gym->SetGetObservationCb(MakeCallback(&GymRecorder::GetObservation, this));
+        gym->SetGetRewardCb(MakeCallback(&GymRecorder::GetReward, this));
+        gym->SetGetGameOverCb(MakeCallback(&GymRecorder::GetGameOver, this));
+        gym->SetGetExtraInfoCb(MakeCallback(&GymRecorder::GetExtraInfo, this));
+        gym->SetExecuteActionsCb(MakeCallback(&GymRecorder::ExecuteActions, this));
+    }
+
+    uint64_t GetNStates() const { return m_nStates; }
+    uint64_t GetNActions() const { return m_nActions; }
+
+    void Close()
+    {
+        if (m_out.is_open()) m_out.close();
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        Close();
+        Object::DoDispose();
+    }
+
+  private:
+    enum Field
+    {
+        HAVE_OBS = 1,
+        HAVE_REWARD = 2,
+        HAVE_GAMEOVER = 4,
+        HAVE_INFO = 8,
+        HAVE_ALL = 15,
+    };
+
+    template <class T>
+    void Put(T v)
+    {
+        m_out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    // Os transportes pedem obs, reward, gameOver e info de cada estado; o
+    // registro sai quando os quatro chegaram, em qualquer ordem
+    void Collected(uint32_t field)
+    {
+        m_have |= field;
+        if (m_have != HAVE_ALL) return;
+        m_have = 0;
+        if (!m_out.is_open()) return;
+        uint8_t nDims = std::min<size_t>(m_shape.size(), 255);
+        Put<uint8_t>('S');
+        Put<double>(Simulator::Now().GetSeconds());
+        Put<float>(m_reward);
+        Put<uint8_t>(m_gameOver);
+        Put<uint8_t>(nDims);
+        for (uint8_t d = 0; d < nDims; ++d) Put<uint32_t>(m_shape[d]);
+        m_out.write(reinterpret_cast<const char *>(m_obs.data()), 4 * m_obs.size());
+        Put<uint32_t>(m_info.size());
+        m_out.write(m_info.data(), m_info.size());
+        m_nStates++;
+        if (m_gameOver) m_out.flush();
+    }
+
+    Ptr<OpenGymDataContainer> GetObservation()
+    {
+        Ptr<OpenGymDataContainer> c = m_obsCb();
+        Ptr<OpenGymBoxContainer<float>> box = DynamicCast<OpenGymBoxContainer<float>>(c);
+        NS_ABORT_MSG_IF(!box, "recordFile exige observacao densa (Box float)");
+        m_shape = box->GetShape();
+        m_obs = box->GetData();
+        // O tensor gravado precisa fechar com o shape declarado
+        size_t n = 1;
+        for (uint32_t d : m_shape) n *= d;
+        m_obs.resize(n, 0.0f);
+        Collected(HAVE_OBS);
+        return c;
+    }
+
+    float GetReward()
+    {
+        m_reward = m_rewardCb();
+        Collected(HAVE_REWARD);
+        return m_reward;
+    }
+
+    bool GetGameOver()
+    {
+        m_gameOver = m_gameOverCb();
+        Collected(HAVE_GAMEOVER);
+        return m_gameOver;
+    }
+
+    std::string GetExtraInfo()
+    {
+        m_info = m_infoCb();
+        Collected(HAVE_INFO);
+        return m_info;
+    }
+
+    bool ExecuteActions(Ptr<OpenGymDataContainer> action)
+    {
+        Ptr<OpenGymBoxContainer<float>> box = DynamicCast<OpenGymBoxContainer<float>>(action);
+        if (box && m_out.is_open()) {
+            std::vector<float> a = box->GetData();
+            Put<uint8_t>('A');
+            Put<double>(Simulator::Now().GetSeconds());
+            Put<uint32_t>(a.size());
+            m_out.write(reinterpret_cast<const char *>(a.data()), 4 * a.size());
+            m_nActions++;
+        }
+        return m_actCb(action);
+    }
+
+    std::ofstream m_out;
+    uint32_t m_have{0};
+    std::vector<uint32_t> m_shape;
+    std::vector<float> m_obs;
+    float m_reward{0.0f};
+    bool m_gameOver{false};
+    std::string m_info;
+    uint64_t m_nStates{0};
+    uint64_t m_nActions{0};
+
+    Callback<Ptr<OpenGymDataContainer>> m_obsCb;
+    Callback<float> m_rewardCb;
+    Callback<bool> m_gameOverCb;
+    Callback<std::string> m_infoCb;
+    Callback<bool, Ptr<OpenGymDataContainer>> m_actCb;
+};
+
+} // namespace ns3
+
+#endif // DDOS_GYM_RECORDER_H
@@ -0,0 +1,302 @@
+// =============================================================================
+//  Detector nativo (--aiMode=iforest): Isolation Forest dentro do processo
+//
+//  Carrega o modelo exportado pelo agent_isolation.py (--export-forest) e
+//  pontua todos os nos a cada passo sem round trip ZMQ/Python. A politica de
+//  isolamento e a mesma do agente: anomalia = decision_function < 0, filtragem
+//  dupla pelo limite 3-sigma de bytes/s (coluna 0), no maximo maxPerStep novos
+//  isolamentos por passo (os piores scores primeiro), no maximo maxTotal nos
+//  isolados ao mesmo tempo (--max-total-isolations do agente: uma rajada de
+//  falsos positivos nao derruba a rede inteira) e cooldown em passos.
+//
+//  Arvores em vetor plano, ordem BFS, filho direito = esquerdo + 1: a descida
+//  e so 'n = left + (x[f] > thr)', sem desvio por lado. O laco externo e por
+//  arvore, entao os nos de uma arvore ficam no cache enquanto todos os nos da
+//  rede passam por ela.
+//
+//  Formato do arquivo: ver export_forest() no agent_isolation.py.
+//
+//  --aiMode=zscore usa so o portao 3-sigma do agente (ZScoreDetector): media e
+//  desvio de bytes/s de todos os nos aprendidos por Welford no warmup, depois
+//  score = -z por no. Mesma IsolationPolicy, custo de poucas operacoes por no.
+// =============================================================================
+#ifndef DDOS_NATIVE_DETECTOR_H
+#define DDOS_NATIVE_DETECTOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class FlatIsolationForest
+{
+  public:
+    // false (com 'err') se o arquivo nao existe ou nao esta no formato
+    bool Load(const std::string &path, std::string &err)
+    {
+        std::ifstream in(path);
+        std::string magic;
+        int version = 0;
+        uint32_t nTrees = 0;
+        if (!in || !(in >> magic >> version) || magic != "ddos-iforest" || version != 1) {
+            err = "cabecalho invalido (esperado 'ddos-iforest 1')";
+            return false;
+        }
+        if (!(in >> nTrees >> m_nFeatures >> m_norm >> m_offset >> m_gate) || nTrees == 0 || m_norm <= 0.0) {
+            err = "parametros do modelo invalidos";
+            return false;
+        }
+        m_nodes.clear();
+        m_roots.clear();
+        for (uint32_t t = 0; t < nTrees; ++t) {
+            uint32_t n = 0;
+            if (!(in >> n) || n == 0) { err = "arvore " + std::to_string(t) + " vazia"; return false; }
+            uint32_t base = m_nodes.size();
+            m_roots.push_back(base);
+            for (uint32_t i = 0; i < n; ++i) {
+                Node nd;
+                if (!(in >> nd.feature >> nd.threshold >> nd.left >> nd.value)) {
+                    err = "no " + std::to_string(i) + " da arvore " + std::to_string(t) + " truncado";
+                    return false;
+                }
+                // Ordem BFS: filhos vem depois do pai (um elo para tras faria o Score() girar para sempre)
+                if (nd.feature >= (int32_t)m_nFeatures || (nd.feature >= 0 && (nd.left <= i || nd.left + 1 >= n))) {
+                    err = "no " + std::to_string(i) + " da arvore " + std::to_string(t) + " invalido";
+                    return false;
+                }
+                if (nd.feature >= 0) nd.left += base;   // indice local -> global
+                m_nodes.push_back(nd);
+            }
+        }
+        return true;
+    }
+
+    uint32_t GetNFeatures() const { return m_nFeatures; }
+    uint32_t GetNTrees() const { return m_roots.size(); }
+    // Limite 3-sigma de bytes/s exportado junto com o modelo
+    double GetGate() const { return m_gate; }
+
+    // decision_function do scikit-learn para as 'nRows' linhas de X
+    // (row-major, GetNFeatures() colunas): < 0 e anomalia
+    void Score(const std::vector<float> &X, uint32_t nRows, std::vector<float> &out) const
+    {
+        m_depth.assign(nRows, 0.0f);
+        const Node *nodes = m_nodes.data();
+        for (uint32_t root : m_roots) {
+            for (uint32_t i = 0; i < nRows; ++i) {
+                const float *x = &X[(size_t)i * m_nFeatures];
+                uint32_t n = root;
+                while (nodes[n].feature >= 0)
+                    n = nodes[n].left + (x[nodes[n].feature] > nodes[n].threshold);
+                m_depth[i] += nodes[n].value;
+            }
+        }
+        out.resize(nRows);
+        for (uint32_t i = 0; i < nRows; ++i)
+            out[i] = (float)(-std::exp2(-m_depth[i] / m_norm) - m_offset);
+    }
+
+  private:
+    struct Node   // 16 bytes
+    {
+        int32_t feature;   // -1: folha
+        float threshold;   // x[feature] > threshold vai para a direita
+        uint32_t left;     // filho esquerdo (direito = left + 1)
+        float value;       // folha: profundidade + c(amostras)
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_roots;
+    uint32_t m_nFeatures{0};
+    double m_norm{1.0};    // nTrees * c(max_samples)
+    double m_offset{0.0};
+    double m_gate{0.0};
+    mutable std::vector<float> m_depth;
+};
+
+// Politica de isolamento do agent_isolation.py, passo a passo
+class IsolationPolicy
+{
+  public:
+    void Init(uint32_t nNodes, uint32_t maxPerStep, uint32_t cooldown, double gate, uint32_t maxTotal = 20)
+    {
+        m_cooldownLeft.assign(nNodes, 0);
+        m_action.assign(nNodes, 0.0f);
+        m_maxPerStep = maxPerStep;
+        m_maxTotal = maxTotal;
+        m_cooldown = cooldown;
+        m_gate = gate;
+        m_totalIsolations = 0;
+    }
+
+    // Limite de bytes/s da filtragem dupla (o zscore so o conhece apos o warmup)
+    void SetGate(double gate) { m_gate = gate; }
+    // Troca orcamento e cooldown no meio do episodio (ramos do --forkAt)
+    void SetBudget(uint32_t maxPerStep, uint32_t cooldown)
+    {
+        m_maxPerStep = maxPerStep;
+        m_cooldown = cooldown;
+    }
+    uint32_t GetMaxPerStep() const { return m_maxPerStep; }
+    uint32_t GetMaxTotal() const { return m_maxTotal; }
+    uint32_t GetCooldown() const { return m_cooldown; }
+    // Indices que nunca sao isolados (ex.: gateways)
+    void SetWhitelist(const std::vector<uint32_t> &idx)
+    {
+        m_whitelist.assign(m_cooldownLeft.size(), false);
+        for (uint32_t i : idx)
+            if (i < m_whitelist.size()) m_whitelist[i] = true;
+    }
+
+    // scores: decision_function por no; traffic[i * stride] = bytes/s do no i.
+    // Devolve a acao 0/1 por no (1 = isolado)
+    const std::vector<float> &Step(const std::vector<float> &scores, const float *traffic, uint32_t stride)
+    {
+        uint32_t n = m_cooldownLeft.size();
+        uint32_t stillIsolated = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            if (m_cooldownLeft[i] > 0) m_cooldownLeft[i]--;
+            stillIsolated += m_cooldownLeft[i] > 0;
+        }
+
+        m_candidates.clear();
+        for (uint32_t i = 0; i < n && i < scores.size(); ++i)
+            if (scores[i] < 0.0f && !(i < m_whitelist.size() && m_whitelist[i])) m_candidates.push_back(i);
+        m_nAnomalies = m_candidates.size();
+        std::sort(m_candidates.begin(), m_candidates.end(),
+                  [&scores](uint32_t a, uint32_t b) { return scores[a] < scores[b]; });
+
+        uint32_t room = stillIsolated < m_maxTotal ? m_maxTotal - stillIsolated : 0;
+        uint32_t allowed = std::min(m_maxPerStep, room);
+        for (uint32_t i : m_candidates) {
+            if (allowed == 0) break;
+            if (m_cooldownLeft[i] > 0) continue;
+            if (traffic[(size_t)i * stride] <= m_gate) continue;
+            m_cooldownLeft[i] = m_cooldown;
+            m_totalIsolations++;
+            allowed--;
+        }
+
+        m_nIsolated = 0;
+        for (uint32_t i = 0; i < n; ++i) {
+            m_action[i] = m_cooldownLeft[i] > 0 ? 1.0f : 0.0f;
+            m_nIsolated += m_cooldownLeft[i] > 0;
+        }
+        return m_action;
+    }
+
+    uint32_t GetNAnomalies() const { return m_nAnomalies; }
+    uint32_t GetNIsolated() const { return m_nIsolated; }
+    uint64_t GetTotalIsolations() const { return m_totalIsolations; }
+
+  private:
+    std::vector<uint32_t> m_cooldownLeft;   // passos restantes de isolamento por no
+    std::vector<float> m_action;
+    std::vector<uint32_t> m_candidates;
+    std::vector<bool> m_whitelist;
+    uint32_t m_maxPerStep{5};
+    uint32_t m_maxTotal{20};       // isolados ao mesmo tempo
+    uint32_t m_cooldown{20};
+    double m_gate{0.0};
+    uint32_t m_nAnomalies{0};
+    uint32_t m_nIsolated{0};
+    uint64_t m_totalIsolations{0};
+};
+
+// Media/variancia corrente (Welford): uma passada, sem somar quadrados grandes
+class RunningStats
+{
+  public:
+    void Add(double x)
+    {
+        m_n++;
+        double d = x - m_mean;
+        m_mean += d / m_n;
+        m_m2 += d * (x - m_mean);
+    }
+    uint64_t Count() const { return m_n; }
+    double Mean() const { return m_mean; }
+    // Desvio populacional, como o np.std do agente
+    double Std() const { return m_n > 1 ? std::sqrt(m_m2 / m_n) : 0.0; }
+
+  private:
+    uint64_t m_n{0};
+    double m_mean{0.0};
+    double m_m2{0.0};
+};
+
+// Portao 3-sigma do agent_isolation.py: ignora idleSteps passos (rede
+// acordando), aprende media/desvio de bytes/s de todos os nos nos warmupSteps
+// seguintes e dai em diante congela o baseline
+class ZScoreDetector
+{
+  public:
+    void Init(uint32_t idleSteps, uint32_t warmupSteps, double sigmas)
+    {
+        m_idle = idleSteps;
+        m_warmup = warmupSteps;
+        m_sigmas = sigmas;
+        m_step = 0;
+        m_stats = RunningStats();
+    }
+
+    bool IsTrained() const { return m_step > m_idle + m_warmup; }
+    double GetMean() const { return m_stats.Mean(); }
+    double GetStd() const { return m_stats.Std(); }
+    double GetGate() const { return m_stats.Mean() + m_sigmas * m_stats.Std(); }
+    // O baseline aprendido continua; muda so o limite (ramos do --forkAt)
+    void SetSigmas(double sigmas) { m_sigmas = sigmas; }
+
+    // traffic[i * stride] = bytes/s do no i. scores = -z depois do warmup e
+    // +1 (nenhuma anomalia) antes. true so no passo em que o baseline congela
+    bool Score(const float *traffic, uint32_t n, uint32_t stride, std::vector<float> &scores)
+    {
+        m_step++;
+        if (!IsTrained()) {
+            if (m_step > m_idle)
+                for (uint32_t i = 0; i < n; ++i) m_stats.Add(traffic[(size_t)i * stride]);
+            scores.assign(n, 1.0f);
+            return false;
+        }
+        double mean = m_stats.Mean();
+        double inv = m_stats.Std() > 0.0 ? 1.0 / m_stats.Std() : 1.0;
+        scores.resize(n);
+        for (uint32_t i = 0; i < n; ++i)
+            scores[i] = (float)(-(traffic[(size_t)i * stride] - mean) * inv);
+        return m_step == m_idle + m_warmup + 1;
+    }
+
+  private:
+    uint32_t m_idle{15};
+    uint32_t m_warmup{150};
+    double m_sigmas{3.0};
+    uint32_t m_step{0};
+    RunningStats m_stats;
+};
+
+// Lista de indices separados por virgula ("" = vazia)
+static bool ParseIndexList(const std::string &csv, std::vector<uint32_t> &out)
+{
+    out.clear();
+    std::stringstream ss(csv);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        if (tok.empty()) continue;
+        char *end = nullptr;
+        long v = std::strtol(tok.c_str(), &end, 10);
+        if (*end != '\0' || v < 0) return false;
+        out.push_back((uint32_t)v);
+    }
+    return true;
+}
+
+} // namespace ns3
+
+#endif // DDOS_NATIVE_DETECTOR_H
@@ -0,0 +1,90 @@
+// =============================================================================
+//  Tabela de identidade dos nos enviada uma unica vez ao agente (ExtraInfo)
+//
+//  O mapeamento indice -> endereco/PAN/papel nao muda durante o episodio, entao
+//  vai so no info do primeiro estado; dai em diante o info leva apenas pares
+//  dinamicos curtos (tempo, onda de ataque ativa, nos isolados), sem custo
+//  O(N) por passo de nenhum dos dois lados.
+//
+//  Formato (pares "chave=valor" separados por ';'):
+//    1o passo:  nodes=0,2001:1::1,1,normal|1,2001:1::2,1,atk1|...;t=0;wave=0;isolated=0;step=1
+//    demais:    t=171;wave=1;isolated=3;step=0.5
+//
+//  Papel (ground truth): normal, atk1 / atk2 (ataca so na onda 1 / 2) ou atk
+//  (ataca nas duas). Com 'wave' o agente sabe quem esta atacando em cada passo
+//  (ver NodeDirectory no agent_isolation.py). 'step' e a duracao do intervalo
+//  coberto pela observacao (varia com --adaptiveStep). Os cenarios acrescentam
+//  reward=..;tp=..;fp=..;fn=.. do passo (ddos_reward.h).
+// =============================================================================
+#ifndef DDOS_NODE_INFO_H
+#define DDOS_NODE_INFO_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <sstream>
+#include <string>
+
+namespace ns3
+{
+
+// Primeiro endereco global (indice 1; o 0 e o link-local) do no
+static Ipv6Address NodeGlobalAddress(Ptr<Node> node)
+{
+    Ptr<Ipv6> ipv6 = node ? node->GetObject<Ipv6>() : nullptr;
+    if (!ipv6) return Ipv6Address::GetAny();
+    for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
+        if (ipv6->GetNAddresses(ifIdx) < 2) continue;
+        return ipv6->GetAddress(ifIdx, 1).GetAddress();
+    }
+    return Ipv6Address::GetAny();
+}
+
+// Onda de ataque ativa em 't' (0 = nenhuma); janelas comuns aos cenarios
+static uint32_t AttackWaveAt(double t)
+{
+    if (t >= 170.0 && t < 220.0) return 1;
+    if (t >= 250.0 && t < 300.0) return 2;
+    return 0;
+}
+
+class NodeInfoChannel
+{
+  public:
+    // Chamar uma vez por no monitorado, depois do enderecamento
+    void Add(uint32_t idx, Ptr<Node> node, uint32_t group, const std::string &role)
+    {
+        m_table << (m_n++ ? "|" : "") << idx << "," << NodeGlobalAddress(node) << "," << group
+                << "," << role;
+    }
+
+    // Info do passo: tabela so na primeira chamada, depois so 'dyn'
+    std::string Next(const std::string &dyn)
+    {
+        if (m_sent) return dyn;
+        m_sent = true;
+        std::string first = "nodes=" + m_table.str() + ";" + dyn;
+        m_table.str(std::string());
+        return first;
+    }
+
+  private:
+    std::ostringstream m_table;
+    uint32_t m_n{0};
+    bool m_sent{false};
+};
+
+// Pares dinamicos comuns: tempo, onda ativa, quantos nos estao isolados e o
+// intervalo (s) coberto pela observacao
+static std::string DynamicStepInfo(uint32_t nIsolated, double stepLen = 1.0)
+{
+    double t = Simulator::Now().GetSeconds();
+    std::ostringstream ss;
+    ss << "t=" << t << ";wave=" << AttackWaveAt(t) << ";isolated=" << nIsolated << ";step=" << stepLen;
+    return ss.str();
+}
+
+} // namespace ns3
+
+#endif // DDOS_NODE_INFO_H
@@ -0,0 +1,180 @@
+// =============================================================================
+//  Codificacao da observacao enviada ao agente (--obsEncoding)
+//
+//  dense   Box {N} ou {N, F}, como sempre foi.
+//  sparse  Dict com so as linhas "ativas" (algum valor > --sparseThreshold):
+//            idx      Box uint32 {k}       indices dos nos ativos
+//            val      Box float  {k, F}    linhas correspondentes
+//            summary  Box float  {3 + F}   N, F, k e a soma de cada coluna
+//                                          sobre TODOS os nos (inclusive os
+//                                          abaixo do limiar)
+//          Com a frota quase toda ociosa, k << N e a serializacao/transferencia
+//          ZMQ cai na mesma proporcao. O agente reconstroi a matriz densa com
+//          zeros nas linhas omitidas (expand_sparse_obs no agent_isolation.py).
+//  quant8  Dict com a matriz quantizada linearmente, escala por passo:
+//  quant16   q        Box uint8/uint16 {N} ou {N, F}
+//            scale    Box float {F}     passo de quantizacao de cada coluna
+//            offset   Box float {F}     minimo de cada coluna neste passo
+//          v ~= offset + q * scale (dequantize_obs no agent_isolation.py).
+//          Inteiros pequenos viram varints de 1-3 bytes no protobuf do
+//          ns3-gym, contra 4 bytes fixos de cada float.
+//
+//  O espaco declarado no modo sparse usa N como tamanho maximo de idx/val;
+//  o container de cada passo leva o k real. sparse/quant* so tratam {N} e
+//  {N, F}; o modo denso aceita qualquer shape.
+// =============================================================================
+#ifndef DDOS_OBS_ENCODING_H
+#define DDOS_OBS_ENCODING_H
+
+#include "ns3/core-module.h"
+#include "ns3/opengym-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+enum ObsEncoding
+{
+    OBS_DENSE,
+    OBS_SPARSE,
+    OBS_QUANT8,
+    OBS_QUANT16,
+};
+
+static bool ParseObsEncoding(const std::string &name, ObsEncoding &out)
+{
+    if (name == "dense")  { out = OBS_DENSE;  return true; }
+    if (name == "sparse") { out = OBS_SPARSE; return true; }
+    if (name == "quant8")  { out = OBS_QUANT8;  return true; }
+    if (name == "quant16") { out = OBS_QUANT16; return true; }
+    return false;
+}
+
+// 'shape' e {N} ou {N, F}, como no modo denso
+static Ptr<OpenGymSpace> EncodedObservationSpace(ObsEncoding enc, const std::vector<uint32_t> &shape)
+{
+    if (enc == OBS_DENSE)
+        return CreateObject<OpenGymBoxSpace>(0.0, 1e9, shape, TypeNameGet<float>());
+
+    uint32_t N = shape[0];
+    uint32_t F = shape.size() > 1 ? shape[1] : 1;
+    Ptr<OpenGymDictSpace> space = CreateObject<OpenGymDictSpace>();
+    if (enc == OBS_QUANT8 || enc == OBS_QUANT16) {
+        bool q8 = (enc == OBS_QUANT8);
+        space->Add("q", CreateObject<OpenGymBoxSpace>(0.0, q8 ? 255.0 : 65535.0, shape,
+                                                      q8 ? TypeNameGet<uint8_t>() : TypeNameGet<uint16_t>()));
+        space->Add("scale", CreateObject<OpenGymBoxSpace>(0.0, 1e9, std::vector<uint32_t>{F},
+                                                          TypeNameGet<float>()));
+        space->Add("offset", CreateObject<OpenGymBoxSpace>(0.0, 1e9, std::vector<uint32_t>{F},
+                                                           TypeNameGet<float>()));
+        return space;
+    }
+    space->Add("idx", CreateObject<OpenGymBoxSpace>(0.0, (float)N, std::vector<uint32_t>{N},
+                                                    TypeNameGet<uint32_t>()));
+    space->Add("val", CreateObject<OpenGymBoxSpace>(0.0, 1e9, std::vector<uint32_t>{N, F},
+                                                    TypeNameGet<float>()));
+    space->Add("summary", CreateObject<OpenGymBoxSpace>(0.0, 1e12, std::vector<uint32_t>{3 + F},
+                                                        TypeNameGet<float>()));
+    return space;
+}
+
+// Quantiza cada coluna de 'data' em [0, levels] com offset = minimo e
+// scale = (maximo - minimo) / levels do proprio passo
+template <typename Q>
+static Ptr<OpenGymDataContainer> QuantizeObservation(const std::vector<uint32_t> &shape,
+                                                     const std::vector<float> &data, uint32_t levels)
+{
+    uint32_t N = shape[0];
+    uint32_t F = shape.size() > 1 ? shape[1] : 1;
+    std::vector<float> lo(F, 0.0f), hi(F, 0.0f);
+    for (uint32_t f = 0; f < F && f < data.size(); ++f) lo[f] = hi[f] = data[f];
+    for (size_t i = 0; i < data.size() && i < (size_t)N * F; ++i) {
+        uint32_t f = i % F;
+        lo[f] = std::min(lo[f], data[i]);
+        hi[f] = std::max(hi[f], data[i]);
+    }
+    std::vector<float> scale(F), inv(F);
+    for (uint32_t f = 0; f < F; ++f) {
+        scale[f] = (hi[f] - lo[f]) / levels;
+        inv[f] = scale[f] > 0.0f ? 1.0f / scale[f] : 0.0f;
+    }
+
+    Ptr<OpenGymBoxContainer<Q>> q = CreateObject<OpenGymBoxContainer<Q>>(shape);
+    for (size_t i = 0; i < (size_t)N * F; ++i) {
+        uint32_t f = i % F;
+        float v = i < data.size() ? data[i] : lo[f];
+        q->AddValue((Q)std::min<float>(levels, std::lround((v - lo[f]) * inv[f])));
+    }
+    Ptr<OpenGymBoxContainer<float>> sc = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{F});
+    Ptr<OpenGymBoxContainer<float>> off = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{F});
+    for (uint32_t f = 0; f < F; ++f) { sc->AddValue(scale[f]); off->AddValue(lo[f]); }
+
+    Ptr<OpenGymDictContainer> dict = CreateObject<OpenGymDictContainer>();
+    dict->Add("q", q);
+    dict->Add("scale", sc);
+    dict->Add("offset", off);
+    return dict;
+}
+
+// 'data' e a matriz row-major N x F (F = 1 no caso {N})
+static Ptr<OpenGymDataContainer> EncodeObservation(ObsEncoding enc, const std::vector<uint32_t> &shape,
+                                                   const std::vector<float> &data, float threshold)
+{
+    uint32_t N = shape[0];
+    uint32_t F = shape.size() > 1 ? shape[1] : 1;
+
+    if (enc == OBS_DENSE) {
+        // Qualquer numero de dimensoes (ex.: {K, N, F} do --stackK)
+        size_t total = 1;
+        for (uint32_t d : shape) total *= d;
+        Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(shape);
+        for (size_t i = 0; i < total; ++i) box->AddValue(i < data.size() ? data[i] : 0.0f);
+        return box;
+    }
+    if (enc == OBS_QUANT8)  return QuantizeObservation<uint8_t>(shape, data, 255);
+    if (enc == OBS_QUANT16) return QuantizeObservation<uint16_t>(shape, data, 65535);
+
+    std::vector<uint32_t> idx;
+    std::vector<float> val;
+    std::vector<double> colSum(F, 0.0);
+    for (uint32_t i = 0; i < N; ++i) {
+        if ((size_t)(i + 1) * F > data.size()) break;
+        const float *row = &data[(size_t)i * F];
+        bool active = false;
+        for (uint32_t f = 0; f < F; ++f) {
+            colSum[f] += row[f];
+            active |= std::fabs(row[f]) > threshold;
+        }
+        if (!active) continue;
+        idx.push_back(i);
+        val.insert(val.end(), row, row + F);
+    }
+
+    uint32_t k = idx.size();
+    Ptr<OpenGymBoxContainer<uint32_t>> idxBox =
+        CreateObject<OpenGymBoxContainer<uint32_t>>(std::vector<uint32_t>{k});
+    for (uint32_t i : idx) idxBox->AddValue(i);
+    Ptr<OpenGymBoxContainer<float>> valBox =
+        CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{k, F});
+    for (float v : val) valBox->AddValue(v);
+    Ptr<OpenGymBoxContainer<float>> sumBox =
+        CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{3 + F});
+    sumBox->AddValue((float)N);
+    sumBox->AddValue((float)F);
+    sumBox->AddValue((float)k);
+    for (double s : colSum) sumBox->AddValue((float)s);
+
+    Ptr<OpenGymDictContainer> dict = CreateObject<OpenGymDictContainer>();
+    dict->Add("idx", idxBox);
+    dict->Add("val", valBox);
+    dict->Add("summary", sumBox);
+    return dict;
+}
+
+} // namespace ns3
+
+#endif // DDOS_OBS_ENCODING_H
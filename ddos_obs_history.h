@@ -0,0 +1,66 @@
+// =============================================================================
+//  Historico de observacoes para o modo multi-passo (--stackK)
+//
+//  Com stackK = K > 1 o cenario amostra uma linha (N ou N x F) a cada
+//  envStepTime, guarda as K ultimas num anel e so chama o agente a cada K
+//  intervalos, entregando o tensor {K, N} ou {K, N, F} (mais antiga primeiro).
+//  A ultima acao continua valendo entre as chamadas. Com K round trips a
+//  menos por janela, execucoes com IA ficam perto de K vezes mais rapidas.
+//
+//  Uso:
+//    g_obsStack.Init(K, N * F);
+//    g_obsStack.Push(linha);            // a cada intervalo
+//    g_obsStack.Flatten(buf);           // na chamada do agente
+// =============================================================================
+#ifndef DDOS_OBS_HISTORY_H
+#define DDOS_OBS_HISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3
+{
+
+class ObservationStack
+{
+  public:
+    void Init(uint32_t depth, uint32_t rowSize)
+    {
+        m_depth = std::max<uint32_t>(1, depth);
+        m_row = rowSize;
+        m_ring.assign((size_t)m_depth * m_row, 0.0f);
+        m_next = 0;
+    }
+
+    // Guarda a linha mais recente (completa com zero ou trunca em rowSize)
+    void Push(const std::vector<float> &row)
+    {
+        float *dst = &m_ring[(size_t)m_next * m_row];
+        size_t n = std::min<size_t>(row.size(), m_row);
+        std::copy_n(row.begin(), n, dst);
+        std::fill(dst + n, dst + m_row, 0.0f);
+        m_next = (m_next + 1) % m_depth;
+    }
+
+    // K linhas em ordem cronologica; antes de K Push() as primeiras sao zero
+    void Flatten(std::vector<float> &out) const
+    {
+        out.resize(m_ring.size());
+        size_t head = (size_t)m_next * m_row;
+        std::copy(m_ring.begin() + head, m_ring.end(), out.begin());
+        std::copy(m_ring.begin(), m_ring.begin() + head, out.begin() + (m_ring.size() - head));
+    }
+
+    uint32_t GetDepth() const { return m_depth; }
+
+  private:
+    uint32_t m_depth{1};
+    uint32_t m_row{0};
+    uint32_t m_next{0};          // slot da proxima linha (= a mais antiga)
+    std::vector<float> m_ring;   // m_depth x m_row
+};
+
+} // namespace ns3
+
+#endif // DDOS_OBS_HISTORY_H
@@ -13,7 +13,17 @@
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ripng-helper.h"
 
+#include <chrono>
 #include <cmath>
+#include <unordered_map>
+
+#include "ddos_action_delta.h"
+#include "ddos_gym_recorder.h"
+#include "ddos_native_detector.h"
+#include "ddos_node_info.h"
+#include "ddos_reward.h"
+#include "ddos_shm_gym.h"
+#include "ddos_step_timer.h"
 
 NS_LOG_COMPONENT_DEFINE("DdosOpengym");
 
@@ -27,10 +37,49 @@ static FlowMonitorHelper flowmonHelper;
 static Ptr<FlowMonitor> flowMonitor;
 static Ptr<Ipv6FlowClassifier> ipv6Classifier; // para mapear flowId -> endereços
 static std::vector<Ptr<Node>> monitoredNodes; // nós que queremos monitorar (ex.: wifiStaNodes2)
-static std::map<uint32_t, uint64_t> lastRxBytesPerFlow; // flowId -> último rxBytes
 static double detectInterval = 1.0; // segundos entre verificações
 static double contamination = 0.1; // fração/contaminação para anomalias (10%)
+static uint32_t g_nNodes = 0; // nós monitorados (wifiStaNodes2.GetN()), definido no main
+static WallClockProfile g_prof; // tempo de parede de setup/observação/ação
+static NodeInfoChannel g_nodeInfo; // tabela de identidade dos nós (só no 1º info)
+static uint32_t g_nIsolated = 0; // nós isolados pela última ação
+static ActionDelta g_actionDelta; // última decisão por nó (só as mudanças são aplicadas)
+static std::vector<Ptr<Ipv6>> g_nodeIpv6; // Ipv6 de cada nó de wifiStaNodes2, resolvido uma vez
+static ZScoreDetector g_zscore; // --aiMode=zscore: portão 3-sigma nativo
+static IsolationPolicy g_policy; // orçamento por passo, cooldown e whitelist
+static std::vector<float> g_scores; // -z por nó no último passo
+static Ptr<GymRecorder> g_recorder; // --recordFile: estados/ações para o replay_env.py
+static RewardTracker g_reward; // recompensa e tp/fp/fn do passo (ground truth do cenário)
+
+// Tabela fluxo -> índice do nó monitorado. Os FlowIds do FlowMonitor são
+// sequenciais, então um vetor indexado pelo flowId basta. Cada fluxo é
+// classificado (FindFlow + busca do endereço) uma única vez, na primeira vez
+// em que aparece; depois disso o laço por passo é só aritmética em vetores.
+static const int32_t FLOW_UNCLASSIFIED = -2; // fluxo ainda não visto
+static const int32_t FLOW_UNMONITORED  = -1; // origem fora de wifiStaNodes2
+static std::unordered_map<Ipv6Address, uint32_t, Ipv6AddressHash> addrToNode; // IP global -> índice
+static std::vector<int32_t> flowToNode;        // flowId -> índice do nó (ou FLOW_*)
+static std::vector<uint64_t> lastRxBytesPerFlow; // flowId -> último rxBytes
+static std::vector<float> nodeThroughputs;     // bytes/s por nó no último intervalo
+
 
+// ----------------------
+// Helper: monta o mapa endereço global -> índice do nó monitorado.
+// Chame depois do endereçamento IPv6 (os endereços precisam existir).
+void BuildNodeIndex()
+{
+    addrToNode.clear();
+    for (uint32_t i = 0; i < wifiStaNodes2.GetN(); ++i) {
+        Ptr<Ipv6> ipv6 = wifiStaNodes2.Get(i)->GetObject<Ipv6>();
+        if (!ipv6) continue;
+        for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
+            // Índice 0 é o link-local; o global vem em seguida
+            if (ipv6->GetNAddresses(ifIdx) < 2) continue;
+            addrToNode[ipv6->GetAddress(ifIdx, 1).GetAddress()] = i;
+        }
+    }
+    nodeThroughputs.assign(wifiStaNodes2.GetN(), 0.0f);
+}
 
 // ----------------------
 // Helper: cria e instala FlowMonitor
@@ -43,45 +92,51 @@ void InstallFlowMonitor()
     if (ipv6Classifier == nullptr) {
         NS_LOG_WARN("Ipv6FlowClassifier not available in this build; flow->address mapping will be unavailable.");
     }
+    flowToNode.clear();
     lastRxBytesPerFlow.clear();
+    BuildNodeIndex();
 }
 
-// Coleta de "throughput" por source node usando FlowMonitor
-// Retorna map: sourceIpv6String -> throughput (bytes/s) durante o intervalo
-std::map<std::string, double> CollectNodeThroughputs(double intervalSeconds)
+// Retorna o índice do nó monitorado que origina o fluxo, classificando-o
+// apenas na primeira vez em que o flowId aparece.
+static int32_t ClassifyFlow(FlowId fid)
 {
-    std::map<std::string, double> nodeThroughputs;
-    std::map<std::string, double> throughputBySrc;
-    if (!flowMonitor) return throughputBySrc;
+    if (fid >= flowToNode.size()) {
+        flowToNode.resize(fid + 1, FLOW_UNCLASSIFIED);
+        lastRxBytesPerFlow.resize(fid + 1, 0);
+    }
+    if (flowToNode[fid] == FLOW_UNCLASSIFIED) {
+        // Ip de origem; Ip de destino; porta origem; porta destino; protocolo
+        Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(fid);
+        auto it = addrToNode.find(t.sourceAddress);
+        flowToNode[fid] = (it != addrToNode.end()) ? (int32_t)it->second : FLOW_UNMONITORED;
+    }
+    return flowToNode[fid];
+}
+
+// Coleta de "throughput" por nó monitorado usando FlowMonitor
+// Retorna vetor indexado pelo nó (bytes/s durante o intervalo)
+const std::vector<float>& CollectNodeThroughputs(double intervalSeconds)
+{
+    std::fill(nodeThroughputs.begin(), nodeThroughputs.end(), 0.0f);
+    if (!flowMonitor) return nodeThroughputs;
+
+    if (ipv6Classifier == nullptr) {
+        std::cout << "[WARNING] ipv6Classifier is null. Skipping throughput classification." << std::endl;
+        return nodeThroughputs;
+    }
 
     flowMonitor->CheckForLostPackets();
-    // Obtem lista de fluxos ativos 
-    std::map<FlowId, FlowMonitor::FlowStats> stats = flowMonitor->GetFlowStats();
+    // Referência para a lista de fluxos ativos (evita copiar o map a cada passo)
+    const FlowMonitor::FlowStatsContainer &stats = flowMonitor->GetFlowStats();
 
-    // Itera sobre cada fluxo e armazena suas estatísticas brutas
+    // Itera sobre cada fluxo e acumula o delta no nó de origem
     for (auto &kv : stats) {
         FlowId fid = kv.first;
-        FlowMonitor::FlowStats fs = kv.second;
-
-        // Mapeamento flow -> five-tuple usando classifier (se disponível)
-        // Ip de origem; Ip de destino; porta origem; porta destino; protocolo
-        Ipv6FlowClassifier::FiveTuple t;
-
-        if (ipv6Classifier == nullptr) {
-            std::cout << "[WARNING] ipv6Classifier is null. Skipping throughput classification." << std::endl;
-            return nodeThroughputs;
-        }
-
-        t = ipv6Classifier->FindFlow(fid);
+        int32_t idx = ClassifyFlow(fid);
 
-        std::ostringstream oss;
-        oss << t.sourceAddress; // operator<< formata o endereço
-        std::string src = oss.str(); // string forma "2001:4::1" etc.
-        uint64_t rxBytes = fs.rxBytes;
-
-        uint64_t prev = 0;
-        if (lastRxBytesPerFlow.count(fid)) 
-            prev = lastRxBytesPerFlow[fid];
+        uint64_t rxBytes = kv.second.rxBytes;
+        uint64_t prev = lastRxBytesPerFlow[fid];
 
         uint64_t delta = 0;
         if (rxBytes >= prev) 
@@ -89,11 +144,10 @@ std::map<std::string, double> CollectNodeThroughputs(double intervalSeconds)
 
         lastRxBytesPerFlow[fid] = rxBytes;
 
-        double bps = (double)delta / intervalSeconds; // bytes por segundo
-        // acumula por IP
-        throughputBySrc[src] += bps;
+        if (idx < 0) continue; // origem não monitorada (APs, outras redes)
+        nodeThroughputs[idx] += (float)((double)delta / intervalSeconds); // bytes por segundo
     }
-    return throughputBySrc;
+    return nodeThroughputs;
 }
 
 /* --------------------------
@@ -102,7 +156,7 @@ std::map<std::string, double> CollectNodeThroughputs(double intervalSeconds)
 
 Ptr<OpenGymSpace> MyGetObservationSpace(void)
 {
-  uint32_t nodeNum = 173; // Nós ativos na rede monitorada
+  uint32_t nodeNum = g_nNodes; // Nós ativos na rede monitorada
   float low = 0.0;
   float high = 1e9; // Tráfego máximo possível
   std::vector<uint32_t> shape = {nodeNum}; // vetor com a quantidade de nós monitorados
@@ -113,7 +167,7 @@ Ptr<OpenGymSpace> MyGetObservationSpace(void)
 
 Ptr<OpenGymSpace> MyGetActionSpace(void)
 {
-    uint32_t N = 173;
+    uint32_t N = g_nNodes;
     std::vector<uint32_t> shape = {N};
     std::vector<float> low(N, 0.0f); // ação 0 = não isolar, 1 = isolar
     std::vector<float> high(N, 1.0f);
@@ -123,61 +177,46 @@ Ptr<OpenGymSpace> MyGetActionSpace(void)
 
 Ptr<OpenGymDataContainer> MyGetObservation(void)
 {
-  uint32_t nodeNum = 173;
+  ScopedWallTimer timer(g_prof, PROF_OBS);
+  uint32_t nodeNum = g_nNodes;
   std::vector<uint32_t> shape = {nodeNum};
   Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(shape);
 
-  // Dicionário para coleta dados reais de throughput a cada intervalo de 1 segundo da simulação
-  std::map<std::string, double> tpMap = CollectNodeThroughputs(1.0);
+  // Throughput por nó (bytes/s) no último intervalo de 1 segundo da simulação,
+  // já indexado pela posição em wifiStaNodes2
+  const std::vector<float> &tp = CollectNodeThroughputs(1.0);
 
   // Mapeia os nós monitorados
-  for (uint32_t i = 0; i < nodeNum && i < wifiStaNodes2.GetN(); i++)
+  for (uint32_t i = 0; i < nodeNum; i++)
   {
-    float val = 0.0f;
-    Ptr<Node> node = wifiStaNodes2.Get(i);
-    
-    if (node) {
-        Ptr<Ipv6> ipv6 = node->GetObject<Ipv6>();
-        if (ipv6) {
-            // Percorre interfaces de rede do nó para encontrar o endereço IPv6 global
-            for(uint32_t ifIdx=0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-                 // Segurança: garante que tem endereço global antes de acessar index 1
-                 if (ipv6->GetNAddresses(ifIdx) < 2) continue;
-
-                 // Armazena e converte para string o IP global
-                 Ipv6Address addr = ipv6->GetAddress(ifIdx, 1).GetAddress();
-                 std::ostringstream oss;
-                 oss << addr;
-                 
-                 // Verifica tráfego encontrado para o IP global e atribui ao vetor de observação
-                 if (tpMap.count(oss.str())) {
-                     val = (float)tpMap[oss.str()];
-                 }
-            }
-        }
-    }
-    box->AddValue(val);
+    box->AddValue(i < tp.size() ? tp[i] : 0.0f);
   }
 
   // --- LOG VISUAL ---
-  std::vector<float> data = box->GetData();
-  std::stringstream ss;
-  ss << "[";
-  for (size_t i = 0; i < data.size(); ++i) {
-      ss << data[i];
-      if (i < data.size() - 1) ss << ", ";
-  }
-  ss << "]";
+  // Só com log de debug: com milhares de nós formatar o vetor inteiro a cada
+  // passo custa mais que a própria observação
+  if (g_log.IsEnabled(LOG_DEBUG))
+  {
+      const std::vector<float> &data = box->GetData();
+      std::stringstream ss;
+      ss << "[";
+      for (size_t i = 0; i < data.size(); ++i) {
+          ss << data[i];
+          if (i < data.size() - 1) ss << ", ";
+      }
+      ss << "]";
 
-  // Imprime o tempo atual e o vetor de dados
-  NS_LOG_UNCOND("MyGetObservation [Time: " << Simulator::Now().GetSeconds() << "s]: " << ss.str());
+      // Imprime o tempo atual e o vetor de dados
+      NS_LOG_DEBUG("MyGetObservation [Time: " << Simulator::Now().GetSeconds() << "s]: " << ss.str());
+  }
 
   return box;
 }
 
 float MyGetReward(void)
 {
-  return 1.0;
+  g_reward.Update();
+  return g_reward.GetReward();
 }
 
 bool MyGetGameOver(void)
@@ -186,50 +225,30 @@ bool MyGetGameOver(void)
 }
 
 // Trata endereços IPv6 para geração de logs
+// Tabela de identidade só no primeiro info; depois só os pares dinâmicos
 std::string MyGetExtraInfo(void)
 {
-  std::stringstream ss;
-  
-  for (uint32_t i = 0; i < wifiStaNodes2.GetN(); ++i) {
-      Ptr<Node> node = wifiStaNodes2.Get(i);
-      if (!node) continue;
-      
-      Ptr<Ipv6> ipv6 = node->GetObject<Ipv6>();
-      if (!ipv6) continue;
-
-      // Busca o endereço global (pula o loopback e link-local)
-      for(uint32_t ifIdx=0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-           if (ipv6->GetNAddresses(ifIdx) < 2) continue; 
-
-           Ipv6Address addr = ipv6->GetAddress(ifIdx, 1).GetAddress();
-           
-           // Formato: INDICE=IP|
-           ss << i << "=" << addr << "|";
-           break; // Pega o primeiro IP global e vai pro próximo nó
-      }
-  }
-  return ss.str();
+  g_reward.Update();
+  return g_nodeInfo.Next(DynamicStepInfo(g_nIsolated) + ";" + g_reward.Info());
 }
 
 // Executa ação de isolamento
 bool MyExecuteActions(Ptr<OpenGymDataContainer> action)
 {
+    ScopedWallTimer timer(g_prof, PROF_ACT);
     // Verifica pacote recebido pelo agente e converte para vetor de ações
     if (!action) return false;
     Ptr<OpenGymBoxContainer<float>> box = DynamicCast<OpenGymBoxContainer<float>>(action);
     if (!box) return false;
 
-    std::vector<float> actions = box->GetData();
-
-    for (uint32_t i = 0; i < actions.size() && i < wifiStaNodes2.GetN(); ++i) {
-        Ptr<Node> node = wifiStaNodes2.Get(i);
-        if (!node) continue;
-
-        Ptr<Ipv6> ipv6 = node->GetObject<Ipv6>();
+    // Só os nós cuja decisão mudou desde a última ação
+    for (uint32_t i : g_actionDelta.Update(box->GetData())) {
+        Ptr<Ipv6> ipv6 = g_nodeIpv6[i];
         if (!ipv6) continue;
+        g_reward.SetIsolated(i, g_actionDelta.IsIsolated(i));
 
         // Verificação segura se agente decidiu isolar (1)
-        if (actions[i] > 0.5f) {
+        if (g_actionDelta.IsIsolated(i)) {
             // Agente decidiu isolar
             for (uint32_t ifIndex = 1; ifIndex < ipv6->GetNInterfaces(); ++ifIndex) {
                 if (ipv6->IsUp(ifIndex)) {
@@ -246,14 +265,67 @@ bool MyExecuteActions(Ptr<OpenGymDataContainer> action)
             }
         }
     }
+    g_nIsolated = g_actionDelta.GetNIsolated();
     return true;
 }
 
+// --aiMode=zscore: a decisão final do agente (3-sigma sobre bytes/s) em C++,
+// sem OpenGym; a ação passa pelo MyExecuteActions de sempre
+void ZScoreStep(double envStepTime)
+{
+  const std::vector<float> *tp;
+  {
+    ScopedWallTimer timer(g_prof, PROF_OBS);
+    tp = &CollectNodeThroughputs(envStepTime);
+    if (g_zscore.Score(tp->data(), g_nNodes, 1, g_scores))
+    {
+      NS_LOG_UNCOND("[ZSCORE] baseline: média " << g_zscore.GetMean() << " desvio " << g_zscore.GetStd()
+                    << " -> limite " << g_zscore.GetGate() << " B/s");
+    }
+  }
+  if (g_zscore.IsTrained())
+  {
+    g_policy.SetGate(g_zscore.GetGate());
+  }
+  const std::vector<float> &act = g_policy.Step(g_scores, tp->data(), 1);
+  Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{g_nNodes});
+  for (float a : act)
+  {
+    box->AddValue(a);
+  }
+  g_reward.Update();
+  MyExecuteActions(box);
+  if (!MyGetGameOver())
+  {
+    Simulator::Schedule(Seconds(envStepTime), &ZScoreStep, envStepTime);
+  }
+}
+
+// Liga os callbacks do cenário ao transporte escolhido (ZMQ ou shm)
+template <class Gym>
+static void ConnectGym(Ptr<Gym> gym)
+{
+  gym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
+  gym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
+  gym->SetGetObservationCb(MakeCallback(&MyGetObservation));
+  gym->SetGetRewardCb(MakeCallback(&MyGetReward));
+  gym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
+  gym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
+  gym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
+  if (g_recorder)
+  {
+    g_recorder->Attach(gym, MakeCallback(&MyGetObservation), MakeCallback(&MyGetReward),
+                       MakeCallback(&MyGetGameOver), MakeCallback(&MyGetExtraInfo),
+                       MakeCallback(&MyExecuteActions));
+  }
+}
+
 // Agendador de eventos nativo do ns3 para o ns3gym
-void ScheduleNextStateRead(double envStepTime, Ptr<OpenGymInterface> openGym)
+// ('notify' é o NotifyCurrentState do transporte em uso)
+void ScheduleNextStateRead(double envStepTime, Callback<void> notify)
 {
-  openGym->NotifyCurrentState();
-  Simulator::Schedule(Seconds(envStepTime), &ScheduleNextStateRead, envStepTime, openGym);
+  notify();
+  Simulator::Schedule(Seconds(envStepTime), &ScheduleNextStateRead, envStepTime, notify);
 }
 
 static Ptr<ListPositionAllocator>
@@ -277,6 +349,7 @@ CreateGridPositionAllocator (uint32_t nNodes, double spacing, double offsetX, do
 int
 main(int argc, char* argv[])
 {
+    auto setupT0 = std::chrono::steady_clock::now();
     LogComponentEnable("Ping", LOG_LEVEL_INFO);
     LogComponentEnable("DdosOpengym", LOG_LEVEL_INFO);
 
@@ -291,22 +364,86 @@ main(int argc, char* argv[])
     uint32_t nWifiCsma = 173; // nCsma renomeado para nWifiCsma
     uint32_t nWifi = 173;
     bool tracing = true;
+    uint32_t openGymPort = 5555; // uma porta por instância (vec_env.py)
+    std::string gymTransport = "zmq"; // zmq | shm
+    bool gymAsync = false; // só com shm: ação aplicada depois de decisionLatency
+    double decisionLatency = 0.1; // s (simulados) entre observação e ação no modo async
+    std::string aiMode = "gym"; // gym (agente Python) | zscore (3-sigma nativo)
+    uint32_t maxIsolations = 5; // novos isolamentos por passo (zscore)
+    uint32_t isolationCooldown = 20; // passos isolado (zscore)
+    uint32_t maxTotalIsolations = 20; // isolados ao mesmo tempo (zscore)
+    uint32_t zIdleSteps = 15; // passos ignorados antes do warmup (zscore)
+    uint32_t zWarmupSteps = 150; // passos de aprendizado do baseline (zscore)
+    double zSigmas = 3.0; // limite = média + zSigmas * desvio
+    std::string whitelist = ""; // índices nunca isolados, ex: 0,5
+    std::string recordFile = ""; // grava a interação com o agente (replay_env.py)
+    double rewardAttackWeight = 1.0; // peso dos kB/s de ataque que chegam na vítima
+    double rewardBenignCost = 1.0; // custo (kB/s equivalentes) por nó isolado fora da onda
 
     CommandLine cmd(__FILE__);
     cmd.AddValue("verbose", "Tell echo applications to log if true", verbose);
     cmd.AddValue("tracing", "Enable pcap tracing", tracing);
+    cmd.AddValue("nWifi", "STAs por rede WiFi (a rede 2 é a monitorada)", nWifi);
+    cmd.AddValue("openGymPort", "Porta ZMQ do OpenGym; com shm o segmento é /dev/shm/ddos_gym_<porta>", openGymPort);
+    cmd.AddValue("gymTransport", "Transporte do OpenGym: zmq (socket) ou shm (memória compartilhada)", gymTransport);
+    cmd.AddValue("gymAsync", "Não para a simulação esperando o agente (exige gymTransport=shm)", gymAsync);
+    cmd.AddValue("decisionLatency", "Latência de decisão do agente no modo async, em segundos simulados", decisionLatency);
+    cmd.AddValue("aiMode", "Mitigação: gym (agente Python via OpenGym) ou zscore (detector 3-sigma nativo)", aiMode);
+    cmd.AddValue("maxIsolations", "zscore: novos isolamentos por passo", maxIsolations);
+    cmd.AddValue("isolationCooldown", "zscore: passos que um nó fica isolado", isolationCooldown);
+    cmd.AddValue("maxTotalIsolations", "zscore: máximo de nós isolados ao mesmo tempo", maxTotalIsolations);
+    cmd.AddValue("zIdleSteps", "zscore: passos ignorados antes do warmup", zIdleSteps);
+    cmd.AddValue("zWarmupSteps", "zscore: passos usados para média/desvio", zWarmupSteps);
+    cmd.AddValue("zSigmas", "zscore: limite = média + zSigmas * desvio", zSigmas);
+    cmd.AddValue("whitelist", "zscore: índices de nós que nunca são isolados (vírgula)", whitelist);
+    cmd.AddValue("recordFile", "Grava observações, info, reward e ações do OpenGym neste arquivo binário (replay_env.py)", recordFile);
+    cmd.AddValue("rewardAttackWeight", "Recompensa: peso dos kB/s de ataque recebidos na vítima", rewardAttackWeight);
+    cmd.AddValue("rewardBenignCost", "Recompensa: custo por nó isolado que não está atacando", rewardBenignCost);
 
     cmd.Parse(argc, argv);
+    nWifiCsma = nWifi; // a rede 3 é criada com nWifi nós
+    if (gymTransport != "zmq" && gymTransport != "shm")
+    {
+        std::cout << "gymTransport inválido: " << gymTransport << " (use zmq ou shm)" << std::endl;
+        return 1;
+    }
+    if (gymAsync && (gymTransport != "shm" || decisionLatency < 0.0))
+    {
+        std::cout << "gymAsync exige gymTransport=shm e decisionLatency >= 0" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> whitelistIdx;
+    if (aiMode != "gym" && aiMode != "zscore")
+    {
+        std::cout << "aiMode inválido: " << aiMode << " (use gym ou zscore)" << std::endl;
+        return 1;
+    }
+    if (!recordFile.empty() && aiMode != "gym")
+    {
+        std::cout << "recordFile exige aiMode=gym" << std::endl;
+        return 1;
+    }
+    if (!ParseIndexList(whitelist, whitelistIdx))
+    {
+        std::cout << "whitelist inválida: " << whitelist << std::endl;
+        return 1;
+    }
 
-    if (nWifi > 200) // segurança para grids gigantes
+    // Os atacantes são os nós 0..19 e o tráfego comum começa no 21
+    if (nWifi < 21)
     {
-        std::cout << "nWifi muito grande; ajuste o script ou aumente a área." << std::endl;
+        std::cout << "nWifi precisa ser >= 21 (atacantes 0..19)." << std::endl;
         return 1;
     }
 
     wifiStaNodes1.Create(nWifi);
     wifiStaNodes2.Create(nWifi);
     wifiStaNodes3.Create(nWifi);
+    g_nNodes = wifiStaNodes2.GetN(); // dimensão da observação/ação
+    g_zscore.Init(zIdleSteps, zWarmupSteps, zSigmas);
+    g_policy.Init(g_nNodes, maxIsolations, isolationCooldown, 0.0, maxTotalIsolations);
+    g_policy.SetWhitelist(whitelistIdx);
 
     NodeContainer p2pNodes;
     p2pNodes.Create(3); // n0=AP1, n1=AP2/WiFi3 AP, n2=AP3
@@ -383,6 +520,9 @@ main(int argc, char* argv[])
     // Parâmetros: espaçamento entre nós na grade e offsets para separar redes
     double spacing = 5.0;    // distância entre STAs (m). Ajuste para maior densidade se quiser mais nós por área.
     double offsetCell = 75.0; // distância entre centros das células -> isola co-canal interference
+    // Com muitos nós a grade passa de 75 m: afasta as células para não sobrepor
+    uint32_t gridSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(std::max(nWifi, nWifiCsma)))));
+    offsetCell = std::max(offsetCell, gridSide * spacing + 25.0);
 
     // Cria alocadores de posição separados para cada rede (mantém as redes fisicamente separadas)
     Ptr<ListPositionAllocator> allocWifi1 = CreateGridPositionAllocator (nWifi, spacing, 0.0, 0.0);
@@ -453,6 +593,10 @@ main(int argc, char* argv[])
     staStack.Install(wifiStaNodes1);
     staStack.Install(wifiStaNodes2);
     staStack.Install(wifiStaNodes3); // Instalar nos novos STAs
+    g_actionDelta.Init(wifiStaNodes2.GetN());
+    g_nodeIpv6.assign(wifiStaNodes2.GetN(), nullptr);
+    for (uint32_t i = 0; i < wifiStaNodes2.GetN(); ++i)
+        g_nodeIpv6[i] = wifiStaNodes2.Get(i)->GetObject<Ipv6>();
 
     // Endereçamento IPv6 (mesma lógica do seu original)
     Ipv6AddressHelper address;
@@ -616,24 +760,56 @@ clientApp.Stop(Seconds(900.0));
         attackApp2.Stop(Seconds(300.0));
     }
 
+    // Tabela de identidade para o agente (grupo = rede WiFi 2)
+    g_reward.Init(wifiStaNodes2.GetN(), rewardAttackWeight, rewardBenignCost);
+    for (uint32_t i = 0; i < wifiStaNodes2.GetN(); ++i)
+    {
+        std::string role = i < 10 ? "atk1" : (i < 20 ? "atk2" : "normal");
+        g_nodeInfo.Add(i, wifiStaNodes2.Get(i), 2, role);
+        g_reward.SetRole(i, role);
+    }
+    g_reward.SetSinks(sinkApp.Get(0), sinkAppAttack.Get(0));
+
     InstallFlowMonitor();
 
     // Simulator::Schedule(Seconds(detectInterval), &DetectAndMitigate, detectInterval, wifiStaNodes2, staDevices2);
   
-    uint32_t openGymPort = 5555;
     double envStepTime = 1.0;
 
-    Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
-    openGym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
-    openGym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
-    openGym->SetGetObservationCb(MakeCallback(&MyGetObservation));
-    openGym->SetGetRewardCb(MakeCallback(&MyGetReward));
-    openGym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
-    openGym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
-    openGym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
+    Callback<void> notify;
+    if (!recordFile.empty())
+    {
+        g_recorder = CreateObject<GymRecorder>(recordFile);
+    }
+    if (aiMode == "zscore")
+    {
+        Simulator::Schedule(Seconds(envStepTime), &ZScoreStep, envStepTime);
+    }
+    else if (gymTransport == "shm")
+    {
+        // Async: observações em voo até a ação chegar = floor(latência / passo) + 1
+        uint32_t nSlots = gymAsync ? (uint32_t)std::floor(decisionLatency / envStepTime) + 2 : 2;
+        Ptr<ShmGymInterface> shm = CreateObject<ShmGymInterface>(
+            "/ddos_gym_" + std::to_string(openGymPort), g_nNodes, g_nNodes, 256 + 64 * g_nNodes, nSlots);
+        if (gymAsync)
+        {
+            shm->SetAsync(Seconds(decisionLatency));
+        }
+        ConnectGym(shm);
+        notify = MakeCallback(&ShmGymInterface::NotifyCurrentState, shm);
+    }
+    else
+    {
+        Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
+        ConnectGym(openGym);
+        notify = MakeCallback(&OpenGymInterface::NotifyCurrentState, openGym);
+    }
 
     // Inicia loop Gym
-    Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, openGym);
+    if (!notify.IsNull())
+    {
+        Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, notify);
+    }
     
     if (tracing)
     {
@@ -648,8 +824,21 @@ clientApp.Stop(Seconds(900.0));
         phy3.EnablePcap("ddosml_highatt_ap3", apDevices3.Get(0)); // AP1
     }
     
+    g_prof.AddSince(PROF_SETUP, setupT0);
     Simulator::Stop(Seconds(901.0));
     Simulator::Run();
+    g_prof.Report(std::cout, g_nNodes);
+    if (aiMode == "zscore")
+    {
+        std::cout << "[ZSCORE] isolamentos no total: " << g_policy.GetTotalIsolations() << std::endl;
+    }
+    std::cout << "[REWARD] " << g_reward.Summary() << std::endl;
+    if (g_recorder)
+    {
+        g_recorder->Close();
+        std::cout << "[INFO] Gravação: " << g_recorder->GetNStates() << " estados, "
+                  << g_recorder->GetNActions() << " ações em " << recordFile << std::endl;
+    }
     Simulator::Destroy();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+// =============================================================================
+//  Recompensa calculada no simulador e contadores de acerto por passo
+//
+//  O cenario ja sabe quem ataca (papel de cada no, onda ativa) e separa o
+//  trafego por porta na vitima (9002 normal, 9001 ataque). A recompensa de
+//  cada passo sai de duas leituras de contador nos sinks e de contagens de
+//  isolados por papel mantidas a cada mudanca de acao (ActionDelta), sem
+//  percorrer nos nem fluxos:
+//
+//    reward = normal_kBps - attackWeight * ataque_kBps - benignCost * fp
+//
+//  com as taxas medidas na vitima no intervalo desde o passo anterior (kB/s,
+//  independente da duracao do passo) e fp = nos isolados que nao pertencem a
+//  onda ativa. tp = isolados da onda ativa, fn = atacantes da onda soltos.
+//  Vao no info de cada estado como reward=..;tp=..;fp=..;fn=.. e os totais do
+//  episodio (precisao/recall) sao impressos no fim.
+// =============================================================================
+#ifndef DDOS_REWARD_H
+#define DDOS_REWARD_H
+
+#include "ddos_node_info.h"
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class RewardTracker
+{
+  public:
+    void Init(uint32_t nNodes, double attackWeight, double benignCost)
+    {
+        m_role.assign(nNodes, 0);
+        m_isolated.assign(nNodes, false);
+        for (uint32_t r = 0; r < 4; ++r) m_nByRole[r] = m_isoByRole[r] = 0;
+        m_nByRole[0] = nNodes;
+        m_attackWeight = attackWeight;
+        m_benignCost = benignCost;
+    }
+
+    // Papel como no NodeInfoChannel: normal, atk1, atk2 ou atk (as duas ondas)
+    void SetRole(uint32_t i, const std::string &role)
+    {
+        if (i >= m_role.size()) return;
+        uint8_t r = role == "atk1" ? 1 : role == "atk2" ? 2 : role == "atk" ? 3 : 0;
+        m_nByRole[m_role[i]]--;
+        if (m_isolated[i]) m_isoByRole[m_role[i]]--;
+        m_role[i] = r;
+        m_nByRole[r]++;
+        if (m_isolated[i]) m_isoByRole[r]++;
+    }
+
+    void SetSinks(Ptr<Application> normalSink, Ptr<Application> attackSink)
+    {
+        m_normalSink = DynamicCast<PacketSink>(normalSink);
+        m_attackSink = DynamicCast<PacketSink>(attackSink);
+    }
+
+    // Chamar para cada no cuja decisao mudou
+    void SetIsolated(uint32_t i, bool isolated)
+    {
+        if (i >= m_isolated.size() || m_isolated[i] == isolated) return;
+        m_isolated[i] = isolated;
+        if (isolated)
+            m_isoByRole[m_role[i]]++;
+        else
+            m_isoByRole[m_role[i]]--;
+    }
+
+    // Fecha o passo em Now(); chamadas repetidas no mesmo instante (reward e
+    // info do mesmo estado) reaproveitam o resultado
+    void Update()
+    {
+        double now = Simulator::Now().GetSeconds();
+        if (now <= m_lastT) return;
+        uint64_t nRx = m_normalSink ? m_normalSink->GetTotalRx() : 0;
+        uint64_t aRx = m_attackSink ? m_attackSink->GetTotalRx() : 0;
+        double dt = now - m_lastT;
+        double normalKBps = (nRx - m_lastNormalRx) / dt / 1000.0;
+        double attackKBps = (aRx - m_lastAttackRx) / dt / 1000.0;
+        m_lastT = now;
+        m_lastNormalRx = nRx;
+        m_lastAttackRx = aRx;
+
+        uint32_t wave = AttackWaveAt(now);
+        uint32_t mask = wave == 0 ? 0 : (1u << (wave - 1));
+        uint32_t positives = 0, nIsolated = 0;
+        m_tp = 0;
+        for (uint32_t r = 0; r < 4; ++r) {
+            nIsolated += m_isoByRole[r];
+            if (!(r & mask)) continue;
+            positives += m_nByRole[r];
+            m_tp += m_isoByRole[r];
+        }
+        m_fp = nIsolated - m_tp;
+        m_fn = positives - m_tp;
+        m_reward = normalKBps - m_attackWeight * attackKBps - m_benignCost * m_fp;
+
+        m_nSteps++;
+        m_sumReward += m_reward;
+        m_sumTp += m_tp;
+        m_sumFp += m_fp;
+        m_sumFn += m_fn;
+    }
+
+    float GetReward() const { return m_reward; }
+
+    // Pares dinamicos do passo para o info
+    std::string Info() const
+    {
+        std::ostringstream ss;
+        ss << "reward=" << m_reward << ";tp=" << m_tp << ";fp=" << m_fp << ";fn=" << m_fn;
+        return ss.str();
+    }
+
+    // Totais do episodio (soma dos passos)
+    std::string Summary() const
+    {
+        double prec = m_sumTp + m_sumFp ? (double)m_sumTp / (m_sumTp + m_sumFp) : 0.0;
+        double rec = m_sumTp + m_sumFn ? (double)m_sumTp / (m_sumTp + m_sumFn) : 0.0;
+        std::ostringstream ss;
+        ss << m_nSteps << " passos, recompensa total " << m_sumReward << ", tp=" << m_sumTp
+           << " fp=" << m_sumFp << " fn=" << m_sumFn << ", precisao " << prec << ", recall " << rec;
+        return ss.str();
+    }
+
+  private:
+    std::vector<uint8_t> m_role;    // bit 0 = onda 1, bit 1 = onda 2
+    std::vector<bool> m_isolated;
+    uint32_t m_nByRole[4]{0, 0, 0, 0};
+    uint32_t m_isoByRole[4]{0, 0, 0, 0};
+    double m_attackWeight{1.0};
+    double m_benignCost{1.0};
+    Ptr<PacketSink> m_normalSink;
+    Ptr<PacketSink> m_attackSink;
+
+    double m_lastT{0.0};
+    uint64_t m_lastNormalRx{0};
+    uint64_t m_lastAttackRx{0};
+    float m_reward{0.0f};
+    uint32_t m_tp{0};
+    uint32_t m_fp{0};
+    uint32_t m_fn{0};
+
+    uint64_t m_nSteps{0};
+    double m_sumReward{0.0};
+    uint64_t m_sumTp{0};
+    uint64_t m_sumFp{0};
+    uint64_t m_sumFn{0};
+};
+
+} // namespace ns3
+
+#endif // DDOS_REWARD_H
@@ -0,0 +1,338 @@
+// =============================================================================
+//  Transporte OpenGym por memoria compartilhada (--gymTransport=shm)
+//
+//  Alternativa ao socket ZMQ do OpenGymInterface para quando o agente roda na
+//  mesma maquina. Mesma API de callbacks (SetGetObservationCb, ...,
+//  NotifyCurrentState), entao o cenario so escolhe qual objeto criar.
+//
+//  Um segmento POSIX (/dev/shm/<nome>) guarda um anel de nSlots observacoes e
+//  um anel de nSlots acoes. Cada lado publica incrementando um contador de
+//  32 bits no cabecalho e acorda o outro com FUTEX_WAKE; quem espera dorme em
+//  FUTEX_WAIT sobre o mesmo contador. Nada de serializacao: a observacao vai
+//  como float32 contiguo, a acao volta do mesmo jeito. O lado Python esta em
+//  shm_env.py (mesmo layout, futex via ctypes).
+//
+//  Layout (little-endian, offsets em bytes):
+//    cabecalho (64)
+//      0 magic 'DGYM'   4 versao        8 nSlots       12 obsCap (floats)
+//     16 actCap (floats) 20 infoCap (bytes) 24 obsSlotBytes 28 actSlotBytes
+//     32 obsHead (futex) 36 actHead (futex) 40 closed 44 detached
+//     48 simPid          52 agentPid
+//    nSlots x slot de observacao (obsSlotBytes cada)
+//      0 seq  4 nDims  8 shape[4]  24 obsLen  28 infoLen  32 reward (f32)
+//     36 gameOver  40 simTime (f64)  48 obs[obsCap] f32  ... info[infoCap]
+//    nSlots x slot de acao (actSlotBytes cada)
+//      0 actLen  4 (reservado)  8 act[actCap] f32
+//
+//  Passo sincrono: o ns-3 publica a observacao h, espera actHead chegar a h+1
+//  e executa a acao do slot h % nSlots. Com gameOver o ns-3 nao espera acao.
+//
+//  Modo assincrono (SetAsync): o ns-3 publica a observacao h e segue rodando;
+//  a acao h e aplicada no instante simulado t_h + latency (o relogio de parede
+//  so para se o agente ainda nao respondeu ate la). Antes de reaproveitar um
+//  slot o ns-3 espera a resposta a observacao que estava nele, entao nSlots
+//  deve cobrir as observacoes em voo: floor(latency / passo) + 2.
+//  Ao destruir o objeto, 'closed' vai a 1 e o agente ve o fim da simulacao.
+//
+//  Do outro lado, o agente escreve o proprio pid ao conectar e poe
+//  'detached' em 1 no close(). Se o ns-3 estiver esperando uma acao e o
+//  agente tiver saido (detached, ou o pid nao existe mais porque ele caiu),
+//  o episodio termina com Simulator::Stop() em vez de esperar para sempre.
+//  O agente, por sua vez, recusa um segmento cujo simPid ja morreu: e sobra
+//  de uma simulacao morta antes do Close(). E o Close() so remove o nome se
+//  o segmento ainda e deste processo: um ns-3 novo na mesma porta pode te-lo
+//  recriado.
+//
+//  So o modo de observacao denso (OpenGymBoxContainer<float>) e suportado.
+// =============================================================================
+#ifndef DDOS_SHM_GYM_H
+#define DDOS_SHM_GYM_H
+
+#include "ns3/core-module.h"
+#include "ns3/opengym-module.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+struct ShmGymHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nSlots;
+    uint32_t obsCap;
+    uint32_t actCap;
+    uint32_t infoCap;
+    uint32_t obsSlotBytes;
+    uint32_t actSlotBytes;
+    std::atomic<uint32_t> obsHead;
+    std::atomic<uint32_t> actHead;
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> detached;   // escrito pelo agente
+    uint32_t simPid;
+    std::atomic<uint32_t> agentPid;   // escrito pelo agente
+    uint32_t reserved[2];
+};
+static_assert(sizeof(ShmGymHeader) == 64, "layout do cabecalho shm mudou");
+
+struct ShmObsSlot
+{
+    uint32_t seq;
+    uint32_t nDims;
+    uint32_t shape[4];
+    uint32_t obsLen;
+    uint32_t infoLen;
+    float reward;
+    uint32_t gameOver;
+    double simTime;
+};
+static_assert(sizeof(ShmObsSlot) == 48, "layout do slot de observacao mudou");
+
+class ShmGymInterface : public Object
+{
+  public:
+    static const uint32_t MAGIC = 0x4d594744;   // "DGYM"
+    static const uint32_t VERSION = 2;
+
+    // obsCap/actCap em floats por passo; infoCap em bytes da string de info
+    ShmGymInterface(const std::string &name, uint32_t obsCap, uint32_t actCap,
+                    uint32_t infoCap, uint32_t nSlots = 2)
+        : m_name(name)
+    {
+        uint32_t obsSlot = Align8(sizeof(ShmObsSlot) + 4 * obsCap + infoCap);
+        uint32_t actSlot = Align8(8 + 4 * actCap);
+        m_size = sizeof(ShmGymHeader) + (size_t)nSlots * (obsSlot + actSlot);
+
+        shm_unlink(m_name.c_str());   // sobra de uma execucao anterior
+        int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0600);
+        NS_ABORT_MSG_IF(fd < 0, "shm_open falhou: " << m_name);
+        NS_ABORT_MSG_IF(ftruncate(fd, m_size) != 0, "ftruncate falhou: " << m_name);
+        void *p = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        NS_ABORT_MSG_IF(p == MAP_FAILED, "mmap falhou: " << m_name);
+        m_base = static_cast<uint8_t *>(p);
+        std::memset(m_base, 0, m_size);
+
+        m_hdr = reinterpret_cast<ShmGymHeader *>(m_base);
+        m_hdr->version = VERSION;
+        m_hdr->nSlots = nSlots;
+        m_hdr->obsCap = obsCap;
+        m_hdr->actCap = actCap;
+        m_hdr->infoCap = infoCap;
+        m_hdr->obsSlotBytes = obsSlot;
+        m_hdr->actSlotBytes = actSlot;
+        m_hdr->simPid = (uint32_t)getpid();
+        std::atomic_thread_fence(std::memory_order_release);
+        m_hdr->magic = MAGIC;   // por ultimo: o agente so le depois disso
+    }
+
+    ~ShmGymInterface() override { Close(); }
+
+    void SetGetObservationSpaceCb(Callback<Ptr<OpenGymSpace>> cb) { m_obsSpaceCb = cb; }
+    void SetGetActionSpaceCb(Callback<Ptr<OpenGymSpace>> cb) { m_actSpaceCb = cb; }
+    void SetGetObservationCb(Callback<Ptr<OpenGymDataContainer>> cb) { m_obsCb = cb; }
+    void SetGetRewardCb(Callback<float> cb) { m_rewardCb = cb; }
+    void SetGetGameOverCb(Callback<bool> cb) { m_gameOverCb = cb; }
+    void SetGetExtraInfoCb(Callback<std::string> cb) { m_infoCb = cb; }
+    void SetExecuteActionsCb(Callback<bool, Ptr<OpenGymDataContainer>> cb) { m_actCb = cb; }
+
+    // A acao de cada observacao passa a valer 'latency' (simulado) depois dela
+    void SetAsync(Time latency)
+    {
+        m_async = true;
+        m_latency = latency;
+    }
+
+    void NotifyCurrentState()
+    {
+        if (!m_hdr || m_gameOver || m_detached) return;
+        uint32_t h = m_hdr->obsHead.load(std::memory_order_relaxed);
+        // O slot ainda guarda a observacao h - nSlots: so reusa depois da resposta
+        if (h >= m_hdr->nSlots && !WaitAtLeast(m_hdr->actHead, h - m_hdr->nSlots + 1)) return;
+        ShmObsSlot *slot = ObsSlot(h);
+        WriteObservation(slot);
+        slot->seq = h;
+        slot->reward = m_rewardCb.IsNull() ? 0.0f : m_rewardCb();
+        m_gameOver = !m_gameOverCb.IsNull() && m_gameOverCb();
+        slot->gameOver = m_gameOver;
+        slot->simTime = Simulator::Now().GetSeconds();
+        WriteInfo(slot);
+        Publish(m_hdr->obsHead, h + 1);
+        if (m_gameOver) return;
+
+        if (m_async)
+            Simulator::Schedule(m_latency, &ShmGymInterface::ApplyAction, this, h);
+        else
+            ApplyAction(h);
+    }
+
+    // Marca o fim da simulacao (o agente sai do passo em que estiver esperando)
+    void Close()
+    {
+        if (!m_base) return;
+        Publish(m_hdr->closed, 1);
+        munmap(m_base, m_size);
+        if (OwnsName()) shm_unlink(m_name.c_str());
+        m_base = nullptr;
+        m_hdr = nullptr;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        Close();
+        Object::DoDispose();
+    }
+
+  private:
+    static uint32_t Align8(size_t n) { return (uint32_t)((n + 7) & ~size_t(7)); }
+
+    // O segmento que hoje tem o nome m_name foi criado por este processo?
+    bool OwnsName() const
+    {
+        int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        uint32_t hdr[sizeof(ShmGymHeader) / 4];
+        bool own = pread(fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+                   hdr[offsetof(ShmGymHeader, simPid) / 4] == (uint32_t)getpid();
+        close(fd);
+        return own;
+    }
+
+    static long Futex(std::atomic<uint32_t> &word, int op, uint32_t val, const timespec *ts)
+    {
+        // Sem FUTEX_PRIVATE_FLAG: a palavra e compartilhada entre processos
+        return syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), op, val, ts, nullptr, 0);
+    }
+
+    static void Publish(std::atomic<uint32_t> &word, uint32_t value)
+    {
+        word.store(value, std::memory_order_release);
+        Futex(word, FUTEX_WAKE, INT32_MAX, nullptr);
+    }
+
+    // Espera word >= want (contadores so crescem); false se a simulacao
+    // fechou ou o agente saiu
+    bool WaitAtLeast(std::atomic<uint32_t> &word, uint32_t want)
+    {
+        uint32_t cur;
+        while ((int32_t)((cur = word.load(std::memory_order_acquire)) - want) < 0) {
+            if (m_hdr->closed.load(std::memory_order_acquire)) return false;
+            if (AgentGone()) {
+                Detach();
+                return false;
+            }
+            timespec ts{1, 0};   // acorda de vez em quando mesmo sem wake
+            Futex(word, FUTEX_WAIT, cur, &ts);
+        }
+        return true;
+    }
+
+    // close() do agente, ou o processo dele nao existe mais
+    bool AgentGone() const
+    {
+        if (m_hdr->detached.load(std::memory_order_acquire)) return true;
+        uint32_t pid = m_hdr->agentPid.load(std::memory_order_acquire);
+        return pid != 0 && kill((pid_t)pid, 0) != 0 && errno == ESRCH;
+    }
+
+    // Sem agente nao ha quem responda: fecha o episodio no instante atual
+    void Detach()
+    {
+        if (m_detached) return;
+        m_detached = true;
+        NS_LOG_UNCOND("[SHM] agente desconectado de " << m_name << " em t=" << Simulator::Now().GetSeconds()
+                      << "s; fim do episodio");
+        Simulator::Stop();
+    }
+
+    ShmObsSlot *ObsSlot(uint32_t seq)
+    {
+        size_t off = sizeof(ShmGymHeader) + (size_t)(seq % m_hdr->nSlots) * m_hdr->obsSlotBytes;
+        return reinterpret_cast<ShmObsSlot *>(m_base + off);
+    }
+
+    uint8_t *ActSlot(uint32_t seq)
+    {
+        size_t off = sizeof(ShmGymHeader) + (size_t)m_hdr->nSlots * m_hdr->obsSlotBytes +
+                     (size_t)(seq % m_hdr->nSlots) * m_hdr->actSlotBytes;
+        return m_base + off;
+    }
+
+    void WriteObservation(ShmObsSlot *slot)
+    {
+        Ptr<OpenGymBoxContainer<float>> box =
+            DynamicCast<OpenGymBoxContainer<float>>(m_obsCb.IsNull() ? nullptr : m_obsCb());
+        NS_ABORT_MSG_IF(!box, "gymTransport=shm exige observacao densa (Box float)");
+        std::vector<uint32_t> shape = box->GetShape();
+        std::vector<float> data = box->GetData();
+        slot->nDims = std::min<size_t>(shape.size(), 4);
+        for (uint32_t d = 0; d < 4; ++d) slot->shape[d] = d < slot->nDims ? shape[d] : 0;
+        slot->obsLen = std::min<size_t>(data.size(), m_hdr->obsCap);
+        float *obs = reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(slot) + sizeof(ShmObsSlot));
+        std::memcpy(obs, data.data(), 4 * (size_t)slot->obsLen);
+    }
+
+    void WriteInfo(ShmObsSlot *slot)
+    {
+        std::string info = m_infoCb.IsNull() ? std::string() : m_infoCb();
+        slot->infoLen = std::min<size_t>(info.size(), m_hdr->infoCap);
+        char *dst = reinterpret_cast<char *>(slot) + sizeof(ShmObsSlot) + 4 * (size_t)m_hdr->obsCap;
+        std::memcpy(dst, info.data(), slot->infoLen);
+    }
+
+    // Espera a resposta a observacao 'seq' e executa
+    void ApplyAction(uint32_t seq)
+    {
+        if (!m_hdr || !WaitAtLeast(m_hdr->actHead, seq + 1)) return;
+        ExecuteAction(seq);
+    }
+
+    void ExecuteAction(uint32_t seq)
+    {
+        if (m_actCb.IsNull()) return;
+        uint8_t *slot = ActSlot(seq);
+        uint32_t n = std::min(*reinterpret_cast<uint32_t *>(slot), m_hdr->actCap);
+        const float *act = reinterpret_cast<const float *>(slot + 8);
+        Ptr<OpenGymBoxContainer<float>> box =
+            CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{n});
+        for (uint32_t i = 0; i < n; ++i) box->AddValue(act[i]);
+        m_actCb(box);
+    }
+
+    std::string m_name;
+    uint8_t *m_base{nullptr};
+    size_t m_size{0};
+    ShmGymHeader *m_hdr{nullptr};
+    bool m_gameOver{false};
+    bool m_detached{false};
+    bool m_async{false};
+    Time m_latency;
+
+    Callback<Ptr<OpenGymSpace>> m_obsSpaceCb;
+    Callback<Ptr<OpenGymSpace>> m_actSpaceCb;
+    Callback<Ptr<OpenGymDataContainer>> m_obsCb;
+    Callback<float> m_rewardCb;
+    Callback<bool> m_gameOverCb;
+    Callback<std::string> m_infoCb;
+    Callback<bool, Ptr<OpenGymDataContainer>> m_actCb;
+};
+
+} // namespace ns3
+
+#endif // DDOS_SHM_GYM_H
@@ -0,0 +1,252 @@
+// =============================================================================
+//  Fila justa por fluxo (ou por origem) para os radios (--radioQdisc=fq / fqcodel)
+//
+//  Substitui a FifoQueueDisc de radioQueue pacotes: cada pacote cai numa de
+//  Flows sub-filas pelo hash do endereco IPv6 de origem (Key=source) ou da
+//  5-tupla (Key=flow), e as sub-filas ativas sao servidas por deficit round
+//  robin com Quantum bytes por rodada. Um pacote normal de 20 bytes espera no
+//  maximo uma rodada, nao a fila inteira do flood.
+//
+//  Memoria limitada: o numero de sub-filas e fixo (origens forjadas so
+//  colidem em baldes ja existentes, com perturbacao aleatoria no hash) e
+//  MaxSize vale para a soma delas; com a fila cheia o pacote da frente da
+//  sub-fila mais longa e descartado.
+//
+//  Com UseCoDel cada sub-fila tem o estado do CoDel (RFC 8289): acima de
+//  Target de espera por Interval, descartes na saida cada vez mais proximos.
+//
+//  Key=flow e o padrao: numa interface de dispositivo so ha uma origem (ele
+//  mesmo) e la Key=source vira uma FIFO. Key=source so separa alguma coisa
+//  numa saida compartilhada por varias origens (ex.: a CSMA do coordenador).
+// =============================================================================
+#ifndef DDOS_SOURCE_FQ_H
+#define DDOS_SOURCE_FQ_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+class SourceFqQueueDisc : public QueueDisc
+{
+  public:
+    static constexpr const char *OVERLIMIT_DROP = "Overlimit drop";
+    static constexpr const char *CODEL_DROP = "CoDel target exceeded";
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::SourceFqQueueDisc")
+                .SetParent<QueueDisc>()
+                .SetGroupName("TrafficControl")
+                .AddConstructor<SourceFqQueueDisc>()
+                .AddAttribute("MaxSize", "Limite da soma das sub-filas",
+                              QueueSizeValue(QueueSize("100p")),
+                              MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                              MakeQueueSizeChecker())
+                .AddAttribute("Flows", "Numero de sub-filas (fixo)", UintegerValue(64),
+                              MakeUintegerAccessor(&SourceFqQueueDisc::m_nFlows),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("Quantum", "Bytes por sub-fila a cada rodada do DRR", UintegerValue(128),
+                              MakeUintegerAccessor(&SourceFqQueueDisc::m_quantum),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("Key", "Chave do hash: source (origem IPv6) ou flow (5-tupla)",
+                              StringValue("flow"),
+                              MakeStringAccessor(&SourceFqQueueDisc::m_key),
+                              MakeStringChecker())
+                .AddAttribute("UseCoDel", "Descarte CoDel em cada sub-fila", BooleanValue(false),
+                              MakeBooleanAccessor(&SourceFqQueueDisc::m_useCoDel),
+                              MakeBooleanChecker())
+                .AddAttribute("Target", "CoDel: espera aceitavel", TimeValue(MilliSeconds(20)),
+                              MakeTimeAccessor(&SourceFqQueueDisc::m_target),
+                              MakeTimeChecker())
+                .AddAttribute("Interval", "CoDel: janela acima do Target antes de descartar",
+                              TimeValue(MilliSeconds(200)),
+                              MakeTimeAccessor(&SourceFqQueueDisc::m_interval),
+                              MakeTimeChecker());
+        return tid;
+    }
+
+    SourceFqQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::MULTIPLE_QUEUES)
+    {
+    }
+
+  private:
+    struct Flow
+    {
+        bool active{false};
+        int64_t deficit{0};
+        // CoDel
+        bool dropping{false};
+        double firstAbove{0.0};
+        double dropNext{0.0};
+        uint32_t count{0};
+        uint32_t lastCount{0};
+    };
+
+    uint32_t Classify(Ptr<QueueDiscItem> item) const
+    {
+        Ptr<Ipv6QueueDiscItem> ip = DynamicCast<Ipv6QueueDiscItem>(item);
+        if (!ip) return 0;
+        if (m_key == "flow") return ip->Hash(m_perturbation) % m_nFlows;
+        uint8_t buf[20];
+        ip->GetHeader().GetSource().GetBytes(buf);
+        std::memcpy(buf + 16, &m_perturbation, 4);
+        return Hash32(reinterpret_cast<const char *>(buf), sizeof(buf)) % m_nFlows;
+    }
+
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override
+    {
+        uint32_t f = Classify(item);
+        if (GetCurrentSize() + item > GetMaxSize()) {
+            // Cheia: a sub-fila mais longa paga (em geral a do flood)
+            uint32_t fat = f;
+            for (uint32_t i = 0; i < m_nFlows; ++i)
+                if (GetInternalQueue(i)->GetNBytes() > GetInternalQueue(fat)->GetNBytes()) fat = i;
+            if (fat == f && GetInternalQueue(f)->IsEmpty()) {
+                DropBeforeEnqueue(item, OVERLIMIT_DROP);
+                return false;
+            }
+            DropAfterDequeue(GetInternalQueue(fat)->Dequeue(), OVERLIMIT_DROP);
+        }
+        item->SetTimeStamp(Simulator::Now());
+        if (!GetInternalQueue(f)->Enqueue(item)) return false;
+        if (!m_flows[f].active) {
+            m_flows[f].active = true;
+            m_flows[f].deficit = m_quantum;
+            m_active.push_back(f);
+        }
+        return true;
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override
+    {
+        while (!m_active.empty()) {
+            uint32_t f = m_active.front();
+            Flow &flow = m_flows[f];
+            if (flow.deficit <= 0) {
+                flow.deficit += m_quantum;
+                m_active.pop_front();
+                m_active.push_back(f);
+                continue;
+            }
+            Ptr<QueueDiscItem> item = m_useCoDel ? CoDelDequeue(f) : GetInternalQueue(f)->Dequeue();
+            if (!item) {
+                flow.active = false;
+                m_active.pop_front();
+                continue;
+            }
+            flow.deficit -= item->GetSize();
+            return item;
+        }
+        return nullptr;
+    }
+
+    // CoDel: ok para descartar se a espera ficou acima do Target por Interval
+    bool ShouldDrop(Flow &flow, Ptr<QueueDiscItem> item, uint32_t f, double now)
+    {
+        double sojourn = now - item->GetTimeStamp().GetSeconds();
+        if (sojourn < m_target.GetSeconds() || GetInternalQueue(f)->GetNBytes() <= m_quantum) {
+            flow.firstAbove = 0.0;
+            return false;
+        }
+        if (flow.firstAbove == 0.0) {
+            flow.firstAbove = now + m_interval.GetSeconds();
+            return false;
+        }
+        return now >= flow.firstAbove;
+    }
+
+    double ControlLaw(double t, uint32_t count) const
+    {
+        return t + m_interval.GetSeconds() / std::sqrt((double)count);
+    }
+
+    Ptr<QueueDiscItem> CoDelDequeue(uint32_t f)
+    {
+        Flow &flow = m_flows[f];
+        Ptr<QueueDiscItem> item = GetInternalQueue(f)->Dequeue();
+        if (!item) {
+            flow.dropping = false;
+            return nullptr;
+        }
+        double now = Simulator::Now().GetSeconds();
+        bool okToDrop = ShouldDrop(flow, item, f, now);
+        if (flow.dropping) {
+            if (!okToDrop) {
+                flow.dropping = false;
+                return item;
+            }
+            while (now >= flow.dropNext && flow.dropping) {
+                DropAfterDequeue(item, CODEL_DROP);
+                flow.count++;
+                item = GetInternalQueue(f)->Dequeue();
+                if (!item) {
+                    flow.dropping = false;
+                    return nullptr;
+                }
+                if (!ShouldDrop(flow, item, f, now))
+                    flow.dropping = false;
+                else
+                    flow.dropNext = ControlLaw(flow.dropNext, flow.count);
+            }
+        } else if (okToDrop) {
+            DropAfterDequeue(item, CODEL_DROP);
+            item = GetInternalQueue(f)->Dequeue();
+            flow.dropping = true;
+            uint32_t delta = flow.count - flow.lastCount;
+            flow.count = (delta > 1 && now - flow.dropNext < 16 * m_interval.GetSeconds()) ? delta : 1;
+            flow.dropNext = ControlLaw(now, flow.count);
+            flow.lastCount = flow.count;
+        }
+        return item;
+    }
+
+    bool CheckConfig() override
+    {
+        if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) return false;
+        if (m_key != "source" && m_key != "flow") return false;
+        if (GetNInternalQueues() == 0) {
+            // Cada sub-fila aceita tudo; o limite e o MaxSize da soma
+            for (uint32_t i = 0; i < m_nFlows; ++i)
+                AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+                    "MaxSize", QueueSizeValue(GetMaxSize())));
+        }
+        return GetNInternalQueues() == m_nFlows;
+    }
+
+    void InitializeParams() override
+    {
+        m_flows.assign(m_nFlows, Flow());
+        m_active.clear();
+        Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable>();
+        m_perturbation = uv->GetInteger(0, 0x7fffffff);
+    }
+
+    uint32_t m_nFlows{64};
+    uint32_t m_quantum{128};
+    std::string m_key{"flow"};
+    bool m_useCoDel{false};
+    Time m_target;
+    Time m_interval;
+    uint32_t m_perturbation{0};
+    std::vector<Flow> m_flows;
+    std::deque<uint32_t> m_active;   // sub-filas com pacotes, na ordem do DRR
+};
+
+NS_OBJECT_ENSURE_REGISTERED(SourceFqQueueDisc);
+
+} // namespace ns3
+
+#endif // DDOS_SOURCE_FQ_H
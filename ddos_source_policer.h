@@ -0,0 +1,253 @@
+// =============================================================================
+//  Policiamento por origem na rede (--mitigation=policer)
+//
+//  Em vez de mexer no no atacante (interface desligada / OnOff em 1 bps), o
+//  gateway descarta o que excede um token bucket por endereco IPv6 de origem.
+//  A acao do agente define taxa e rajada do bucket de cada no; soltar o no
+//  devolve o bucket ao estado sem limite.
+//
+//  Tabela com enderecamento aberto (sondagem linear, capacidade potencia de
+//  2, carga <= 1/2): a consulta de cada pacote e um hash de 16 bytes e,
+//  quase sempre, uma comparacao. Origens sem entrada passam direto; entradas
+//  nunca sao removidas (soltar so tira o limite), entao nao ha lapides.
+//
+//  Dois pontos de instalacao, a mesma tabela:
+//    SourcePolicerQueueDisc  root qdisc na saida de um gateway que encaminha
+//                            (coordenadores do ddos_80215, interface CSMA)
+//    SourcePolicerIngress    entrada de um dispositivo cujo no e o destino
+//                            (AP do ddos_sweep1: o trafego nao sai por fila)
+// =============================================================================
+#ifndef DDOS_SOURCE_POLICER_H
+#define DDOS_SOURCE_POLICER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ns3
+{
+
+class SourcePolicerTable : public SimpleRefCount<SourcePolicerTable>
+{
+  public:
+    SourcePolicerTable() { m_slots.resize(64); }
+
+    // Limita 'src' a rateBps com rajada de burstBytes (0 / 0 = descarta tudo)
+    void SetLimit(const Ipv6Address &src, uint64_t rateBps, uint32_t burstBytes)
+    {
+        Slot &s = Find(src, true);
+        s.limited = true;
+        s.rate = rateBps / 8.0;
+        s.burst = burstBytes;
+        s.tokens = burstBytes;
+        s.last = Simulator::Now().GetSeconds();
+    }
+
+    // Tira o limite de 'src' (a entrada fica, sem custo extra por pacote)
+    void Release(const Ipv6Address &src)
+    {
+        Slot &s = Find(src, false);
+        if (s.used) s.limited = false;
+    }
+
+    // true se o pacote de 'bytes' vindo de 'src' esta dentro do bucket
+    bool Conform(const Ipv6Address &src, uint32_t bytes)
+    {
+        Slot &s = Find(src, false);
+        if (!s.used || !s.limited) {
+            m_nPassed++;
+            return true;
+        }
+        double now = Simulator::Now().GetSeconds();
+        s.tokens = std::min<double>(s.burst, s.tokens + (now - s.last) * s.rate);
+        s.last = now;
+        if (s.tokens >= bytes) {
+            s.tokens -= bytes;
+            m_nPassed++;
+            return true;
+        }
+        m_nDropped++;
+        m_droppedBytes += bytes;
+        return false;
+    }
+
+    uint64_t GetNPassed() const { return m_nPassed; }
+    uint64_t GetNDropped() const { return m_nDropped; }
+    uint64_t GetDroppedBytes() const { return m_droppedBytes; }
+
+  private:
+    struct Slot
+    {
+        uint64_t hi{0};
+        uint64_t lo{0};
+        bool used{false};
+        bool limited{false};
+        double rate{0.0};     // bytes/s
+        double burst{0.0};    // bytes
+        double tokens{0.0};
+        double last{0.0};
+    };
+
+    static void Key(const Ipv6Address &a, uint64_t &hi, uint64_t &lo)
+    {
+        uint8_t b[16];
+        a.GetBytes(b);
+        std::memcpy(&hi, b, 8);
+        std::memcpy(&lo, b + 8, 8);
+    }
+
+    static uint64_t Hash(uint64_t hi, uint64_t lo)
+    {
+        uint64_t h = (hi ^ (lo * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 32);
+    }
+
+    // Slot de 'src'; sem a entrada devolve um slot livre (ocupado se 'insert')
+    Slot &Find(const Ipv6Address &src, bool insert)
+    {
+        uint64_t hi, lo;
+        Key(src, hi, lo);
+        size_t mask = m_slots.size() - 1;
+        size_t i = Hash(hi, lo) & mask;
+        while (m_slots[i].used && (m_slots[i].hi != hi || m_slots[i].lo != lo)) i = (i + 1) & mask;
+        if (m_slots[i].used || !insert) return m_slots[i];
+        if (2 * (m_nUsed + 1) > m_slots.size()) {
+            Grow();
+            return Find(src, true);
+        }
+        m_slots[i].used = true;
+        m_slots[i].hi = hi;
+        m_slots[i].lo = lo;
+        m_nUsed++;
+        return m_slots[i];
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> old;
+        old.swap(m_slots);
+        m_slots.resize(2 * old.size());
+        size_t mask = m_slots.size() - 1;
+        for (const Slot &s : old) {
+            if (!s.used) continue;
+            size_t i = Hash(s.hi, s.lo) & mask;
+            while (m_slots[i].used) i = (i + 1) & mask;
+            m_slots[i] = s;
+        }
+    }
+
+    std::vector<Slot> m_slots;
+    size_t m_nUsed{0};
+    uint64_t m_nPassed{0};
+    uint64_t m_nDropped{0};
+    uint64_t m_droppedBytes{0};
+};
+
+// Root qdisc FIFO que passa cada pacote IPv6 pela tabela antes de enfileirar
+class SourcePolicerQueueDisc : public QueueDisc
+{
+  public:
+    static constexpr const char *POLICED_DROP = "Policed";
+    static constexpr const char *LIMIT_EXCEEDED_DROP = "Queue disc limit exceeded";
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::SourcePolicerQueueDisc")
+                .SetParent<QueueDisc>()
+                .SetGroupName("TrafficControl")
+                .AddConstructor<SourcePolicerQueueDisc>()
+                .AddAttribute("MaxSize", "Tamanho maximo da fila",
+                              QueueSizeValue(QueueSize("100p")),
+                              MakeQueueSizeAccessor(&QueueDisc::SetMaxSize, &QueueDisc::GetMaxSize),
+                              MakeQueueSizeChecker());
+        return tid;
+    }
+
+    SourcePolicerQueueDisc()
+        : QueueDisc(QueueDiscSizePolicy::SINGLE_INTERNAL_QUEUE)
+    {
+    }
+
+    void SetTable(Ptr<SourcePolicerTable> table) { m_table = table; }
+
+  private:
+    bool DoEnqueue(Ptr<QueueDiscItem> item) override
+    {
+        Ptr<Ipv6QueueDiscItem> ip = DynamicCast<Ipv6QueueDiscItem>(item);
+        if (ip && m_table && !m_table->Conform(ip->GetHeader().GetSource(), item->GetSize())) {
+            DropBeforeEnqueue(item, POLICED_DROP);
+            return false;
+        }
+        if (GetCurrentSize() + item > GetMaxSize()) {
+            DropBeforeEnqueue(item, LIMIT_EXCEEDED_DROP);
+            return false;
+        }
+        return GetInternalQueue(0)->Enqueue(item);
+    }
+
+    Ptr<QueueDiscItem> DoDequeue() override { return GetInternalQueue(0)->Dequeue(); }
+
+    Ptr<const QueueDiscItem> DoPeek() override { return GetInternalQueue(0)->Peek(); }
+
+    bool CheckConfig() override
+    {
+        if (GetNQueueDiscClasses() > 0 || GetNPacketFilters() > 0) return false;
+        if (GetNInternalQueues() == 0)
+            AddInternalQueue(CreateObjectWithAttributes<DropTailQueue<QueueDiscItem>>(
+                "MaxSize", QueueSizeValue(GetMaxSize())));
+        return GetNInternalQueues() == 1;
+    }
+
+    void InitializeParams() override {}
+
+    Ptr<SourcePolicerTable> m_table;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(SourcePolicerQueueDisc);
+
+// Policiamento na entrada de dispositivos cujo no e o destino do trafego:
+// troca o callback de recepcao do dispositivo (Node::NonPromiscReceiveFromDevice)
+// por um que consulta a tabela e entrega o resto direto ao TrafficControlLayer,
+// que e o unico tratador IPv6 registrado no dispositivo
+class SourcePolicerIngress : public Object
+{
+  public:
+    explicit SourcePolicerIngress(Ptr<SourcePolicerTable> table)
+        : m_table(table)
+    {
+    }
+
+    // Chamar depois do InternetStackHelper (o TrafficControlLayer ja existe)
+    void Install(Ptr<NetDevice> dev)
+    {
+        Ptr<TrafficControlLayer> tc = dev->GetNode()->GetObject<TrafficControlLayer>();
+        NS_ABORT_MSG_IF(!tc, "policer de entrada sem pilha IP");
+        // TrafficControlLayer resolvido uma vez: o callback roda a cada pacote do flood
+        dev->SetReceiveCallback(MakeCallback(&SourcePolicerIngress::Receive, this).Bind(tc));
+    }
+
+  private:
+    bool Receive(Ptr<TrafficControlLayer> tc, Ptr<NetDevice> dev, Ptr<const Packet> p, uint16_t protocol,
+                 const Address &from)
+    {
+        Ipv6Header h;
+        if (protocol == Ipv6L3Protocol::PROT_NUMBER && p->PeekHeader(h) &&
+            !m_table->Conform(h.GetSource(), p->GetSize()))
+            return true;   // descartado na entrada
+        tc->Receive(dev, p, protocol, from, dev->GetAddress(), NetDevice::PACKET_HOST);
+        return true;
+    }
+
+    Ptr<SourcePolicerTable> m_table;
+};
+
+} // namespace ns3
+
+#endif // DDOS_SOURCE_POLICER_H
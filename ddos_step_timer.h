@@ -0,0 +1,90 @@
+// =============================================================================
+//  Cronometro de parede para setup, observacao e acao do OpenGym
+//
+//  Serve para conferir que o custo cresce linearmente com o numero de nos
+//  monitorados: o relatorio final mostra, alem do total e do pior passo, o
+//  custo medio por no e por passo. Rodando com N = 173, 1000, 10000 esse valor
+//  (us/no) deve ficar aproximadamente constante; se subir com N, algum laco
+//  virou quadratico.
+//
+//  Uso:
+//    auto t0 = std::chrono::steady_clock::now();    // inicio do main
+//    g_prof.AddSince(PROF_SETUP, t0);               // antes do Simulator::Run
+//    { ScopedWallTimer t(g_prof, PROF_OBS); ... }   // dentro do callback
+//    g_prof.Report(std::cout, g_nNodes);            // depois do Simulator::Run
+// =============================================================================
+#ifndef DDOS_STEP_TIMER_H
+#define DDOS_STEP_TIMER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace ns3
+{
+
+enum ProfileSlot
+{
+    PROF_SETUP,   // montagem do cenario (main ate o Simulator::Run)
+    PROF_OBS,     // MyGetObservation
+    PROF_ACT,     // MyExecuteActions
+    PROF_SLOTS,
+};
+
+class WallClockProfile
+{
+  public:
+    void Add(ProfileSlot s, double secs)
+    {
+        m_sum[s] += secs;
+        m_max[s] = std::max(m_max[s], secs);
+        m_n[s]++;
+    }
+    void AddSince(ProfileSlot s, std::chrono::steady_clock::time_point t0)
+    {
+        Add(s, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+
+    void Report(std::ostream &os, uint32_t nNodes) const
+    {
+        static const char *names[PROF_SLOTS] = {"setup", "obs", "act"};
+        double n = std::max<uint32_t>(1, nNodes);
+        os << "[PERF] N=" << nNodes << "\n";
+        for (int s = 0; s < PROF_SLOTS; ++s) {
+            if (!m_n[s]) continue;
+            double mean = m_sum[s] / m_n[s];
+            os << "[PERF] " << names[s] << ": " << m_n[s] << "x, total " << m_sum[s] << " s"
+               << ", media " << mean * 1e3 << " ms, pior " << m_max[s] * 1e3 << " ms"
+               << ", " << mean * 1e6 / n << " us/no\n";
+        }
+    }
+
+  private:
+    double m_sum[PROF_SLOTS] = {};
+    double m_max[PROF_SLOTS] = {};
+    uint64_t m_n[PROF_SLOTS] = {};
+};
+
+// Mede o escopo em que foi criado e soma no slot ao sair
+class ScopedWallTimer
+{
+  public:
+    ScopedWallTimer(WallClockProfile &prof, ProfileSlot slot)
+        : m_prof(prof), m_slot(slot), m_t0(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedWallTimer()
+    {
+        m_prof.AddSince(m_slot, m_t0);
+    }
+
+  private:
+    WallClockProfile &m_prof;
+    ProfileSlot m_slot;
+    std::chrono::steady_clock::time_point m_t0;
+};
+
+} // namespace ns3
+
+#endif // DDOS_STEP_TIMER_H
@@ -19,11 +19,30 @@
 #include "ns3/traffic-control-module.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <set>
+#include <unordered_map>
 #include <vector>
 #include <fstream>
 
+#include "ddos_action_delta.h"
+#include "ddos_adaptive_step.h"
+#include "ddos_flow_sampler.h"
+#include "ddos_fork_branch.h"
+#include "ddos_gym_recorder.h"
+#include "ddos_mac_deny.h"
+#include "ddos_native_detector.h"
+#include "ddos_node_info.h"
+#include "ddos_obs_encoding.h"
+#include "ddos_obs_history.h"
+#include "ddos_reward.h"
+#include "ddos_shm_gym.h"
+#include "ddos_source_fq.h"
+#include "ddos_source_policer.h"
+#include "ddos_step_timer.h"
+#include "ddos_trace_counters.h"
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("DdosApCentral");
@@ -33,33 +52,76 @@ NS_LOG_COMPONENT_DEFINE("DdosApCentral");
 // ----------------------------------------------------------------------------
 static NodeContainer monitoredNodes;        
 static uint32_t g_nNodes = 173;             
+static WallClockProfile g_prof;             // tempo de parede de setup/observacao/acao
 static Ptr<Node> g_ap;                      
 static bool g_attack = false;               
+static bool g_traceObs = false;             // true: observacao via ddos_trace_counters.h
+static std::vector<TrafficFeature> g_obsFeat; // features por no (--obsFeatures)
+static std::vector<double> g_ewmaHorizons; // horizontes (s) das features ewma*
+static bool g_featureObs = false;           // true: observacao N x F das features
+static std::vector<float> g_featBuf;        // matriz N x F do ultimo intervalo
+static ObsEncoding g_obsEnc = OBS_DENSE;    // --obsEncoding
+static float g_sparseThreshold = 0.0f;      // --sparseThreshold
+static uint32_t g_stackK = 1;               // --stackK (intervalos por chamada do agente)
+static ObservationStack g_obsStack;         // ultimas K linhas (so com stackK > 1)
+static std::vector<float> g_stackBuf;       // tensor K x N (x F) entregue ao agente
+static uint64_t g_stepTick = 0;             // intervalos de envStepTime ja decorridos
+static FlatIsolationForest g_forest;         // --aiMode=iforest: modelo exportado pelo agente
+static IsolationPolicy g_policy;            // politica de isolamento do agente, em C++
+static std::vector<float> g_scores;         // decision_function por no no ultimo passo
+static NodeInfoChannel g_nodeInfo;          // tabela de identidade (so no 1o info)
+static uint32_t g_nIsolated = 0;            // nos isolados pela ultima acao
+static std::string g_attackRate = "5Mbps";  // taxa dos atacantes (restaurada ao soltar o no)
+static ApplicationContainer g_attackApps;   // OnOff dos atacantes (ramos mudam a taxa)
+static ActionDelta g_actionDelta;           // ultima decisao por dispositivo (so as mudancas sao aplicadas)
+static std::vector<std::vector<Ptr<OnOffApplication>>> g_nodeApps; // OnOff por dispositivo: [0] normal, demais ataque
+static std::vector<BranchSpec> g_branchSpecs; // --branches
+static BranchRunner g_branches;             // --forkAt: um filho por ramo
+static uint32_t g_forkJobs = 0;             // filhos simultaneos (0 = todos)
+static Ptr<GymRecorder> g_recorder;         // --recordFile: estados/acoes para o replay_env.py
+static bool g_adaptiveStep = false;         // --adaptiveStep: passo do agente segue o detector
+static AdaptiveStepper g_stepper;           // passo grosso/fino pela taxa recebida na vitima
+static ApplicationContainer g_sinkApps;     // sinks da vitima (AP)
+static EventId g_nextRead;                  // proxima leitura do agente (pode ser antecipada)
+static double g_lastRead = 0.0;             // instante (s) da ultima leitura
+static double g_stepLen = 0.0;              // intervalo coberto pela ultima observacao
+static RewardTracker g_reward;              // recompensa e tp/fp/fn do passo (ground truth do cenario)
+static Ptr<SourcePolicerTable> g_policer;   // --mitigation=policer: token buckets por origem no AP
+static Ptr<SourcePolicerIngress> g_policerIngress; // entrada dos radios do AP (o AP e a vitima)
+static uint64_t g_policerRate = 0;          // bps do bucket de um dispositivo isolado
+static uint32_t g_policerBurst = 0;         // bytes de rajada do bucket
+static uint64_t g_rateBaseline = 0;         // --actionMode=rate: taxa base por dispositivo (0 = acao binaria)
+static std::vector<Ipv6Address> g_nodeAddr; // endereco global de cada dispositivo (chave do policer)
+static Ptr<MacDenyList> g_macDeny;          // --mitigation=macdeny: bloqueio na MAC dos radios do AP
+static std::vector<Ptr<LrWpanNetDevice>> g_nodeLrDev; // radio 802.15.4 de cada dispositivo (enderecos MAC)
 
 static FlowMonitorHelper flowmonHelper;
 static Ptr<FlowMonitor> flowMonitor;
 static Ptr<Ipv6FlowClassifier> ipv6Classifier;
-static std::map<uint32_t, uint64_t> lastTxBytesPerFlow;
+
+// Uma fotografia do FlowMonitor por segundo: log, observacao e relatorio final
+static FlowIntervalSampler g_flowSampler;
 
 static std::ofstream g_flowCsv;
-static std::map<ns3::FlowId, uint64_t> g_lastTxB, g_lastRxB;
+static std::string g_tag = "apcentral";
 
 // Contadores de descarte
 static uint64_t g_macTxDrop=0, g_macRxDrop=0, g_phyRxDrop=0, g_sixDrop=0;
 static void MacTxDropCb(Ptr<const Packet>) { g_macTxDrop++; }
 static void MacRxDropCb(Ptr<const Packet>) { g_macRxDrop++; }
 static void PhyRxDropCb(Ptr<const Packet>) { g_phyRxDrop++; }
+static uint64_t g_macDenyDrop=0;
+static void MacDenyDropCb(Ptr<const Packet>) { g_macDenyDrop++; }
 static void SixDropCb(SixLowPanNetDevice::DropReason, Ptr<const Packet>, Ptr<SixLowPanNetDevice>, uint32_t) { g_sixDrop++; }
 static uint64_t g_queueDrop=0;
 static void QueueDropCb(Ptr<const QueueDiscItem> item) { g_queueDrop++; }
 
 void ImprimirDescartes() {
-    flowMonitor->CheckForLostPackets();
-    auto stats = flowMonitor->GetFlowStats();
+    if (g_branches.IsParent()) return;   // parado no forkAt; os ramos imprimem os seus
+    g_flowSampler.Snapshot();
     uint64_t tx=0, rx=0;
-    for (auto &kv : stats) {
-        Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(kv.first);
-        if (t.destinationPort == 9002) { tx += kv.second.txPackets; rx += kv.second.rxPackets; }
+    for (const auto &f : g_flowSampler.Flows()) {
+        if (f.dstPort == 9002) { tx += f.txPkts; rx += f.rxPkts; }
     }
     std::cout << "\n=== PERDA DO TRAFEGO NORMAL (porta 9002) ===\n";
     if (tx) std::cout << "TX=" << tx << "  RX=" << rx
@@ -69,6 +131,7 @@ void ImprimirDescartes() {
               << "MacTxDrop (colisao / sem ACK)          : " << g_macTxDrop << "\n"
               << "MacRxDrop (fila / malformado)          : " << g_macRxDrop << "\n"
               << "PhyRxDrop (interferencia)              : " << g_phyRxDrop << "\n"
+              << "MacDenyDrop (bloqueio na MAC do AP)    : " << g_macDenyDrop << "\n"
               << "SixLowPan Drop (fragmentacao)          : " << g_sixDrop  << "\n";
 }
 
@@ -76,113 +139,112 @@ void InstallFlowMonitor() {
     flowMonitor = flowmonHelper.InstallAll();
     ipv6Classifier = DynamicCast<Ipv6FlowClassifier>(flowmonHelper.GetClassifier6());
     if (!ipv6Classifier) NS_LOG_WARN("Ipv6FlowClassifier indisponivel.");
-    lastTxBytesPerFlow.clear();
+    g_flowSampler.Install(flowMonitor, ipv6Classifier, monitoredNodes);
 }
 
-std::map<std::string, double> CollectNodeThroughputs(double intervalSeconds) {
-    std::map<std::string, double> tpBySrc;
-    if (!flowMonitor || !ipv6Classifier) return tpBySrc;
-    flowMonitor->CheckForLostPackets();
-    auto stats = flowMonitor->GetFlowStats();
-    for (auto &kv : stats) {
-        ns3::FlowId fid = kv.first;
-        Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(fid);
-        std::ostringstream oss; oss << t.sourceAddress;
-        uint64_t txBytes = kv.second.txBytes;
-        uint64_t prev = lastTxBytesPerFlow.count(fid) ? lastTxBytesPerFlow[fid] : 0;
-        uint64_t delta = (txBytes >= prev) ? (txBytes - prev) : 0;
-        lastTxBytesPerFlow[fid] = txBytes;
-        tpBySrc[oss.str()] += (double)delta / intervalSeconds;
-    }
-    return tpBySrc;
+const std::vector<float>& FlowNodeTxRates() {
+    g_flowSampler.Sample(FLOW_OBS);
+    return g_flowSampler.NodeTxRates();
 }
 
 // ---- OpenGym (indexado pelo dispositivo, 0..g_nNodes-1) ----
-Ptr<OpenGymSpace> MyGetObservationSpace() {
+// {N} com uma feature por dispositivo, {N, F} com varias
+static uint32_t ObservationColumns() {
+    return g_featureObs ? TrafficFeatureColumns(g_obsFeat, g_ewmaHorizons.size()) : 1;
+}
+// {K, N} / {K, N, F} com --stackK=K > 1
+static std::vector<uint32_t> ObservationShape() {
+    uint32_t cols = ObservationColumns();
     std::vector<uint32_t> shape = {g_nNodes};
-    return CreateObject<OpenGymBoxSpace>(0.0, 1e9, shape, TypeNameGet<float>());
+    if (cols > 1) shape.push_back(cols);
+    if (g_stackK > 1) shape.insert(shape.begin(), g_stackK);
+    return shape;
+}
+Ptr<OpenGymSpace> MyGetObservationSpace() {
+    return EncodedObservationSpace(g_obsEnc, ObservationShape());
 }
 Ptr<OpenGymSpace> MyGetActionSpace() {
     std::vector<uint32_t> shape = {g_nNodes};
     std::vector<float> low(g_nNodes, 0.0f), high(g_nNodes, 1.0f);
     return CreateObject<OpenGymBoxSpace>(low, high, shape, "float32");
 }
+// Linha N (ou N x F) do intervalo que acabou de fechar, em g_featBuf
+static void SampleObservationRow() {
+    if (g_featureObs) {
+        TrafficFeatureMatrix(g_obsFeat, g_featBuf);   // N x F acumulada no intervalo
+    } else {
+        const std::vector<float> &tp = g_traceObs ? TrafficTxRates() : FlowNodeTxRates();
+        g_featBuf.assign(g_nNodes, 0.0f);
+        std::copy_n(tp.begin(), std::min<size_t>(tp.size(), g_nNodes), g_featBuf.begin());
+    }
+}
 Ptr<OpenGymDataContainer> MyGetObservation() {
-    std::vector<uint32_t> shape = {g_nNodes};
-    Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(shape);
-    auto tpMap = CollectNodeThroughputs(1.0);
-    for (uint32_t i = 0; i < g_nNodes && i < monitoredNodes.GetN(); i++) {
-        float val = 0.0f;
-        Ptr<Ipv6> ipv6 = monitoredNodes.Get(i)->GetObject<Ipv6>();
-        if (ipv6) for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-            if (ipv6->GetNAddresses(ifIdx) < 2) continue;
-            std::ostringstream oss; oss << ipv6->GetAddress(ifIdx, 1).GetAddress();
-            if (tpMap.count(oss.str())) val = (float)tpMap[oss.str()];
-        }
-        box->AddValue(val);
+    ScopedWallTimer timer(g_prof, PROF_OBS);
+    std::vector<uint32_t> shape = ObservationShape();
+    if (g_stackK > 1) {   // linhas ja amostradas a cada intervalo
+        g_obsStack.Flatten(g_stackBuf);
+        return EncodeObservation(g_obsEnc, shape, g_stackBuf, g_sparseThreshold);
     }
-    return box;
+    SampleObservationRow();
+    return EncodeObservation(g_obsEnc, shape, g_featBuf, g_sparseThreshold);
+}
+float MyGetReward() {
+    g_reward.Update();
+    return g_reward.GetReward();
 }
-float MyGetReward() { return 1.0; }
 bool  MyGetGameOver() { return Now().GetSeconds() >= 900.0; }
 std::string MyGetExtraInfo() {
-    std::stringstream ss;
-    for (uint32_t i = 0; i < monitoredNodes.GetN(); ++i) {
-        Ptr<Ipv6> ipv6 = monitoredNodes.Get(i)->GetObject<Ipv6>();
-        if (!ipv6) continue;
-        for (uint32_t ifIdx = 0; ifIdx < ipv6->GetNInterfaces(); ++ifIdx) {
-            if (ipv6->GetNAddresses(ifIdx) < 2) continue;
-            ss << i << "=" << ipv6->GetAddress(ifIdx, 1).GetAddress() << "|"; break;
-        }
-    }
-    return ss.str();
+    g_reward.Update();
+    return g_nodeInfo.Next(DynamicStepInfo(g_nIsolated, g_stepLen) + ";" + g_reward.Info());
 }
 bool MyExecuteActions(Ptr<OpenGymDataContainer> action) {
+    ScopedWallTimer timer(g_prof, PROF_ACT);
     if (!action) return false;
     Ptr<OpenGymBoxContainer<float>> box = DynamicCast<OpenGymBoxContainer<float>>(action);
     if (!box) return false;
-    std::vector<float> actions = box->GetData();
-    
-    for (uint32_t i = 0; i < actions.size() && i < monitoredNodes.GetN(); ++i) {
-        bool isolate = actions[i] > 0.5f;
-        
-        Ptr<Node> node = monitoredNodes.Get(i);
-        // Agora o nó pode ter até 3 aplicações (0: Normal, 1: Ataque 1, 2: Ataque 2)
-        for (uint32_t a = 0; a < node->GetNApplications(); ++a) {
-            Ptr<OnOffApplication> onoff = DynamicCast<OnOffApplication>(node->GetApplication(a));
-            if (onoff) {
-                if (isolate) {
-                    onoff->SetAttribute("DataRate", StringValue("1bps")); // Isola totalmente
-                } else {
-                    if (a == 0) {
-                        onoff->SetAttribute("DataRate", StringValue("50kbps")); // Restaura tráfego normal
-                    } else {
-                        onoff->SetAttribute("DataRate", StringValue("5Mbps"));  // Restaura ataques
-                    }
-                }
-            }
+
+    // So os dispositivos cuja decisao mudou; DataRate por valor, sem parse de string
+    for (uint32_t i : g_actionDelta.Update(box->GetData())) {
+        bool isolate = g_actionDelta.IsIsolated(i);
+        g_reward.SetIsolated(i, isolate);
+        if (g_policer) {   // na rede: o AP limita a origem, o dispositivo segue transmitindo
+            double allowed = g_actionDelta.GetAllowed(i);
+            if (g_rateBaseline > 0 && allowed < 1.0)   // acao graduada: passa a * taxa base
+                g_policer->SetLimit(g_nodeAddr[i], (uint64_t)(allowed * g_rateBaseline), g_policerBurst);
+            else if (g_rateBaseline == 0 && isolate)
+                g_policer->SetLimit(g_nodeAddr[i], g_policerRate, g_policerBurst);
+            else
+                g_policer->Release(g_nodeAddr[i]);
+            continue;
+        }
+        if (g_macDeny) {   // o AP descarta os quadros do dispositivo logo apos o cabecalho MAC
+            if (isolate)
+                g_macDeny->Deny(g_nodeLrDev[i]);
+            else
+                g_macDeny->Allow(g_nodeLrDev[i]);
+            continue;
+        }
+        const std::vector<Ptr<OnOffApplication>> &apps = g_nodeApps[i];
+        for (uint32_t a = 0; a < apps.size(); ++a) {
+            if (isolate)
+                apps[a]->SetAttribute("DataRate", DataRateValue(DataRate(1)));        // Isola totalmente
+            else if (a == 0)
+                apps[a]->SetAttribute("DataRate", DataRateValue(DataRate(50000)));    // Restaura tráfego normal
+            else
+                apps[a]->SetAttribute("DataRate", DataRateValue(DataRate(g_attackRate))); // Restaura ataques
         }
     }
+    g_nIsolated = g_actionDelta.GetNIsolated();
     return true;
 }
 
 void LogFlowPerSecond() {
-    if (flowMonitor && ipv6Classifier) {
-        flowMonitor->CheckForLostPackets();
-        auto stats = flowMonitor->GetFlowStats();
+    if (g_flowSampler.IsReady()) {
+        g_flowSampler.Sample(FLOW_CSV);
         double nTx=0,nRx=0,aTx=0,aRx=0;
-        for (auto &kv : stats) {
-            ns3::FlowId fid = kv.first;
-            const auto &fs = kv.second;
-            Ipv6FlowClassifier::FiveTuple t = ipv6Classifier->FindFlow(fid);
-            
-            uint64_t dtx = fs.txPackets - g_lastTxB[fid];
-            uint64_t drx = fs.rxPackets - g_lastRxB[fid];
-            g_lastTxB[fid] = fs.txPackets; 
-            g_lastRxB[fid] = fs.rxPackets;
-            
-            if (t.destinationPort == 9002) { nTx += dtx; nRx += drx; }
-            else if (t.destinationPort == 9001) { aTx += dtx; aRx += drx; }
+        for (const auto &f : g_flowSampler.Flows()) {
+            if (f.dstPort == 9002) { nTx += f.dTxPkts; nRx += f.dRxPkts; }
+            else if (f.dstPort == 9001) { aTx += f.dTxPkts; aRx += f.dRxPkts; }
         }
         double now = Simulator::Now().GetSeconds();
         g_flowCsv << now << "," << nTx << "," << nRx << "," << aTx << "," << aRx << "\n";
@@ -190,20 +252,154 @@ void LogFlowPerSecond() {
     }
     Simulator::Schedule(Seconds(1.0), &LogFlowPerSecond);
 }
-void ScheduleNextStateRead(double envStepTime, Ptr<OpenGymInterface> openGym) {
-    openGym->NotifyCurrentState();
-    Simulator::Schedule(Seconds(envStepTime), &ScheduleNextStateRead, envStepTime, openGym);
+// Liga os callbacks do cenario ao transporte escolhido (ZMQ ou shm)
+template <class Gym>
+static void ConnectGym(Ptr<Gym> gym) {
+    gym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
+    gym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
+    gym->SetGetObservationCb(MakeCallback(&MyGetObservation));
+    gym->SetGetRewardCb(MakeCallback(&MyGetReward));
+    gym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
+    gym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
+    gym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
+    if (g_recorder)
+        g_recorder->Attach(gym, MakeCallback(&MyGetObservation), MakeCallback(&MyGetReward),
+                           MakeCallback(&MyGetGameOver), MakeCallback(&MyGetExtraInfo),
+                           MakeCallback(&MyExecuteActions));
+}
+// 'notify' e o NotifyCurrentState do transporte em uso. Com stackK > 1 cada
+// intervalo vira uma linha do historico e o agente so e chamado a cada K.
+void ScheduleNextStateRead(double envStepTime, Callback<void> notify) {
+    double now = Simulator::Now().GetSeconds();
+    g_stepLen = now - g_lastRead;
+    g_lastRead = now;
+    if (g_stackK > 1) {
+        SampleObservationRow();
+        g_obsStack.Push(g_featBuf);
+    }
+    if (g_stepTick++ % g_stackK == 0 || MyGetGameOver()) notify();
+    // Com --adaptiveStep o passo segue o detector; nenhum passo atravessa os
+    // 900 s, para o agente ver o gameOver
+    double next = g_adaptiveStep ? g_stepper.StepAt(now) : envStepTime;
+    if (now < 900.0) next = std::min(next, 900.0 - now);
+    g_nextRead = Simulator::Schedule(Seconds(next), &ScheduleNextStateRead, envStepTime, notify);
+}
+// Bytes recebidos ate agora pelos sinks da vitima
+static uint64_t VictimRxBytes() {
+    uint64_t rx = 0;
+    for (uint32_t i = 0; i < g_sinkApps.GetN(); ++i)
+        rx += DynamicCast<PacketSink>(g_sinkApps.Get(i))->GetTotalRx();
+    return rx;
+}
+// --adaptiveStep: sonda a taxa da vitima a cada fineStep; um disparo no meio
+// de um passo grosso antecipa a proxima leitura (no maximo fineStep depois
+// da ultima)
+void AdaptiveStepProbe(double envStepTime, Callback<void> notify) {
+    double now = Simulator::Now().GetSeconds();
+    double fine = g_stepper.GetFineStep();
+    if (g_stepper.Probe(now, VictimRxBytes())) {
+        Simulator::Cancel(g_nextRead);
+        double wait = std::max(0.0, g_lastRead + fine - now);
+        g_nextRead = Simulator::Schedule(Seconds(wait), &ScheduleNextStateRead, envStepTime, notify);
+    }
+    if (!MyGetGameOver()) Simulator::Schedule(Seconds(fine), &AdaptiveStepProbe, envStepTime, notify);
+}
+// --aiMode=iforest: mesmo ciclo observa -> pontua -> isola do agente Python,
+// sem sair do processo; a acao passa pelo MyExecuteActions de sempre
+void NativeDetectorStep(double envStepTime) {
+    {
+        ScopedWallTimer timer(g_prof, PROF_OBS);
+        SampleObservationRow();
+        g_forest.Score(g_featBuf, g_nNodes, g_scores);
+    }
+    const std::vector<float> &act = g_policy.Step(g_scores, g_featBuf.data(), ObservationColumns());
+    Ptr<OpenGymBoxContainer<float>> box = CreateObject<OpenGymBoxContainer<float>>(std::vector<uint32_t>{g_nNodes});
+    for (float a : act) box->AddValue(g_rateBaseline > 0 ? 1.0f - a : a);   // actionMode=rate: isolar = liberar 0
+    g_reward.Update();
+    MyExecuteActions(box);
+    if (g_policy.GetNAnomalies() > 0)
+        NS_LOG_UNCOND("[IFOREST] t=" << Now().GetSeconds() << "s anomalias=" << g_policy.GetNAnomalies()
+                      << " isolados=" << g_policy.GetNIsolated());
+    if (!MyGetGameOver()) Simulator::Schedule(Seconds(envStepTime), &NativeDetectorStep, envStepTime);
 }
-void SaveFlowMonXml(std::string tag) {
+void SaveFlowMonXml() {
     flowMonitor->CheckForLostPackets();
-    flowMonitor->SerializeToXmlFile("ddos-flowmon-sweep1" + tag + ".xml", true, true);
-    std::cout << "[INFO] XML gravado: ddos-flowmon-sweep1" << tag << ".xml\n";
+    flowMonitor->SerializeToXmlFile("ddos-flowmon-sweep1" + g_tag + ".xml", true, true);
+    std::cout << "[INFO] XML gravado: ddos-flowmon-sweep1" << g_tag << ".xml\n";
+}
+// Parametros de um ramo do --forkAt; com apply=false so valida
+static bool ApplyBranch(const BranchSpec &b, bool apply, std::string &err) {
+    for (const auto &kv : b.params) {
+        const std::string &key = kv.first, &val = kv.second;
+        if (key == "attackRate") {
+            std::string rate = (val == "0") ? "1bps" : val;   // 0 = ataque desligado daqui em diante
+            DataRateValue check;
+            if (g_attackApps.GetN() == 0 || !check.DeserializeFromString(rate, MakeDataRateChecker())) {
+                err = "attackRate invalido no ramo " + b.name + ": " + val + " (exige --attack=true)";
+                return false;
+            }
+            if (!apply) continue;
+            g_attackRate = rate;
+            // Isolados pelo OnOff ficam em 1bps e pegam a taxa nova quando forem
+            // soltos; com policer/macdeny eles continuam transmitindo
+            bool inNetwork = g_policer || g_macDeny;
+            for (uint32_t i = 0; i < g_nodeApps.size(); ++i)
+                for (uint32_t a = 1; a < g_nodeApps[i].size() && (inNetwork || !g_actionDelta.IsIsolated(i)); ++a)
+                    g_nodeApps[i][a]->SetAttribute("DataRate", DataRateValue(DataRate(rate)));
+        } else if (key == "maxIsolations" || key == "isolationCooldown") {
+            char *end = nullptr;
+            unsigned long n = std::strtoul(val.c_str(), &end, 10);
+            if (val.empty() || *end != '\0') {
+                err = key + " invalido no ramo " + b.name + ": " + val;
+                return false;
+            }
+            if (apply && key == "maxIsolations") g_policy.SetBudget(n, g_policy.GetCooldown());
+            if (apply && key == "isolationCooldown") g_policy.SetBudget(g_policy.GetMaxPerStep(), n);
+        } else {
+            err = "parametro desconhecido no ramo " + b.name + ": " + key
+                  + " (use attackRate, maxIsolations ou isolationCooldown)";
+            return false;
+        }
+    }
+    return true;
+}
+// --forkAt: o pai espera os ramos e para; cada filho aplica o seu ramo,
+// ganha arquivos de saida proprios e segue a simulacao
+void ForkBranches() {
+    g_flowCsv.flush();
+    int b = g_branches.Fork(g_branchSpecs.size(), g_forkJobs);
+    if (b < 0) {
+        Simulator::Stop();
+        return;
+    }
+    const BranchSpec &spec = g_branchSpecs[b];
+    std::string err;
+    ApplyBranch(spec, true, err);   // ja validado no main
+    std::string parentCsv = "flowmon_persec_" + g_tag + ".csv";
+    g_tag += "-" + spec.name;
+    if (!BranchCopyOutput(g_flowCsv, parentCsv, "flowmon_persec_" + g_tag + ".csv"))
+        NS_LOG_WARN("ramo " << spec.name << ": falha ao copiar o CSV por segundo");
+    NS_LOG_UNCOND("[FORK] ramo " << spec.name << " (pid " << getpid() << ") a partir de t="
+                  << Simulator::Now().GetSeconds() << "s");
+}
+// Resumo do filho para o pai (ver colunas no ReportBranches do main)
+static std::string BranchSummary() {
+    g_flowSampler.Snapshot();
+    uint64_t nTx=0, nRx=0, aTx=0, aRx=0;
+    for (const auto &f : g_flowSampler.Flows()) {
+        if (f.dstPort == 9002) { nTx += f.txPkts; nRx += f.rxPkts; }
+        else if (f.dstPort == 9001) { aTx += f.txPkts; aRx += f.rxPkts; }
+    }
+    std::ostringstream ss;
+    ss << nTx << "," << nRx << "," << aTx << "," << aRx << "," << g_policy.GetTotalIsolations();
+    return ss.str();
 }
 
 // =============================================================================
 //  MAIN
 // =============================================================================
 int main(int argc, char* argv[]) {
+    auto setupT0 = std::chrono::steady_clock::now();
     LogComponentEnable("DdosApCentral", LOG_LEVEL_INFO);
 
     uint32_t nMonitored = 173;
@@ -214,9 +410,43 @@ int main(int argc, char* argv[]) {
     // VARIÁVEIS DE CONTROLO PRINCIPAL (Podem ser alteradas via terminal)
     bool attack    = true; 
     bool useAi     = false; // <-- CHAVE MESTRA DA IA (Desligada por padrão)
+    std::string obsBackend = "flowmon"; // flowmon | trace
+    std::string obsFeatures = "txBytes"; // txBytes,txPkts,meanSize,iatVar,delivery,delay,drops,ewmaBytes,ewmaPkts
+    std::string ewmaHorizons = "1,5,30"; // horizontes (s) de ewmaBytes/ewmaPkts
+    std::string obsEncoding = "dense";  // dense | sparse | quant8 | quant16
+    uint32_t openGymPort = 5555;          // uma porta por instancia (vec_env.py)
+    std::string gymTransport = "zmq";   // zmq | shm
+    std::string aiMode = "gym";           // gym (agente Python) | iforest (detector nativo)
+    std::string forestFile = "iforest.txt"; // modelo do agent_isolation.py --export-forest
+    uint32_t maxIsolations = 5;           // novos isolamentos por passo (iforest)
+    uint32_t isolationCooldown = 20;      // passos isolado (iforest)
+    uint32_t maxTotalIsolations = 20;     // isolados ao mesmo tempo (iforest)
+    bool gymAsync = false;                // so com shm: acao aplicada depois de decisionLatency
+    double decisionLatency = 0.1;         // s (simulados) entre observacao e acao no modo async
+    double forkAt = 0.0;                  // s; > 0 liga os ramos (fork) a partir desse instante
+    std::string branches = "";            // ramos do forkAt, ex: semAtaque:attackRate=0;leve:attackRate=1Mbps
+    std::string recordFile = "";          // grava a interacao com o agente (replay_env.py)
+    double coarseStep = 10.0;             // s; passo do agente com a rede dentro do baseline
+    double fineStep = 0.5;                // s; passo depois de um disparo (e periodo da sonda)
+    double stepHold = 20.0;               // s no passo fino depois do ultimo disparo
+    double stepIdle = 15.0;               // s ignorados antes de aprender o baseline da vitima
+    double stepLearn = 60.0;              // s de aprendizado do baseline
+    double stepSigmas = 4.0;              // disparo: |taxa - media| > stepSigmas * desvio
+    double rewardAttackWeight = 1.0;      // peso dos kB/s de ataque que chegam na vitima
+    double rewardBenignCost = 1.0;        // custo (kB/s equivalentes) por no isolado fora da onda
+    std::string mitigation = "node";      // node (OnOff do dispositivo em 1bps) | policer (token bucket no AP) | macdeny (MAC do AP)
+    std::string policerRate = "0bps";     // taxa permitida a um dispositivo isolado com mitigation=policer
+    uint32_t policerBurst = 0;            // rajada (bytes) do bucket de um dispositivo isolado
+    std::string actionMode = "binary";    // binary (a > 0.5 isola) | rate (a = fracao liberada da taxa base)
+    std::string rateBaseline = "";        // taxa base por dispositivo com actionMode=rate ("" = carga media do OnOff normal)
+    uint32_t rateLevels = 10;             // niveis da acao graduada (mudancas menores sao ignoradas)
 
     bool staticNd  = true;
     uint32_t radioQueue = 100; 
+    std::string radioQdisc = "fifo";      // fifo | fq (DRR por fluxo) | fqcodel (fq + CoDel por sub-fila)
+    std::string fqKey = "flow";           // fq: hash pela 5-tupla (so flow: cada radio tem uma origem)
+    uint32_t fqFlows = 64;                // fq: sub-filas (memoria fixa, origens forjadas colidem)
+    uint32_t fqQuantum = 128;             // fq: bytes por sub-fila a cada rodada
     bool tracing   = false;
     std::string tag = "apcentral";
 
@@ -227,25 +457,195 @@ int main(int argc, char* argv[]) {
     Config::SetDefault("ns3::Icmpv6L4Protocol::RetransmissionTime", TimeValue(MilliSeconds(10)));
 
     CommandLine cmd(__FILE__);
+    cmd.AddValue("nMonitored",  "Dispositivos monitorados (dimensao da observacao/acao)", nMonitored);
     cmd.AddValue("nodesPerPan", "Dispositivos por canal 802.15.4", nodesPerPan);
     cmd.AddValue("normalRate",  "Taxa por dispositivo (ex: 200bps,100bps,67bps)", normalRate);
     cmd.AddValue("normalPkt",   "Bytes de payload por pacote normal", normalPkt);
     cmd.AddValue("attack",      "Liga o ataque DDoS", attack);
     cmd.AddValue("useAi",       "Liga o Agente Python OpenGym", useAi); // <-- Adicionado ao CMD
+    cmd.AddValue("obsBackend",  "Fonte da observacao: flowmon (FlowMonitor) ou trace (traces Ipv6/6LoWPAN)", obsBackend);
+    cmd.AddValue("obsFeatures", "Features por dispositivo, separadas por virgula (txBytes,txPkts,meanSize,iatVar,delivery,delay,drops,ewmaBytes,ewmaPkts)", obsFeatures);
+    cmd.AddValue("ewmaHorizons", "Horizontes EWMA em segundos, separados por virgula (ex: 1,5,30)", ewmaHorizons);
+    cmd.AddValue("obsEncoding", "Codificacao da observacao: dense, sparse (so linhas acima do limiar), quant8 ou quant16", obsEncoding);
+    cmd.AddValue("sparseThreshold", "Limiar do modo sparse: linha vai se algum valor passar dele", g_sparseThreshold);
+    cmd.AddValue("stackK", "Intervalos empilhados por chamada do agente (1 = uma chamada por envStepTime)", g_stackK);
+    cmd.AddValue("openGymPort", "Porta ZMQ do OpenGym; com shm o segmento e /dev/shm/ddos_gym_<porta>", openGymPort);
+    cmd.AddValue("gymTransport", "Transporte do OpenGym: zmq (socket) ou shm (memoria compartilhada)", gymTransport);
+    cmd.AddValue("aiMode",      "Com useAi: gym (agente Python via OpenGym) ou iforest (Isolation Forest nativo)", aiMode);
+    cmd.AddValue("forestFile",  "Modelo do --aiMode=iforest (agent_isolation.py --export-forest)", forestFile);
+    cmd.AddValue("maxIsolations", "iforest: novos isolamentos por passo", maxIsolations);
+    cmd.AddValue("isolationCooldown", "iforest: passos que um no fica isolado", isolationCooldown);
+    cmd.AddValue("maxTotalIsolations", "iforest: maximo de dispositivos isolados ao mesmo tempo", maxTotalIsolations);
+    cmd.AddValue("gymAsync", "Nao para a simulacao esperando o agente (exige gymTransport=shm)", gymAsync);
+    cmd.AddValue("decisionLatency", "Latencia de decisao do agente no modo async, em segundos simulados", decisionLatency);
+    cmd.AddValue("forkAt", "Roda ate este instante (s) uma vez e faz fork de um filho por ramo (0 = desligado)", forkAt);
+    cmd.AddValue("branches", "Ramos do forkAt: nome:chave=valor,...;... (attackRate, maxIsolations, isolationCooldown)", branches);
+    cmd.AddValue("forkJobs", "Ramos rodando ao mesmo tempo (0 = todos)", g_forkJobs);
+    cmd.AddValue("recordFile", "Grava observacoes, info, reward e acoes do OpenGym neste arquivo binario (replay_env.py)", recordFile);
+    cmd.AddValue("adaptiveStep", "Passo do agente grosso na rede calma e fino quando a taxa da vitima muda", g_adaptiveStep);
+    cmd.AddValue("coarseStep", "adaptiveStep: passo (s) dentro do baseline", coarseStep);
+    cmd.AddValue("fineStep", "adaptiveStep: passo (s) apos um disparo e periodo da sonda", fineStep);
+    cmd.AddValue("stepHold", "adaptiveStep: segundos no passo fino apos o ultimo disparo", stepHold);
+    cmd.AddValue("stepIdle", "adaptiveStep: segundos ignorados antes do baseline", stepIdle);
+    cmd.AddValue("stepLearn", "adaptiveStep: segundos de aprendizado do baseline da vitima", stepLearn);
+    cmd.AddValue("stepSigmas", "adaptiveStep: disparo com |taxa - media| > stepSigmas * desvio", stepSigmas);
+    cmd.AddValue("rewardAttackWeight", "Recompensa: peso dos kB/s de ataque recebidos na vitima", rewardAttackWeight);
+    cmd.AddValue("rewardBenignCost", "Recompensa: custo por no isolado que nao esta atacando", rewardBenignCost);
+    cmd.AddValue("mitigation", "Isolamento: node (OnOff do dispositivo em 1bps), policer (token bucket por origem no AP) ou macdeny (descarte na MAC do AP)", mitigation);
+    cmd.AddValue("policerRate", "mitigation=policer: taxa permitida a um dispositivo isolado (0bps = descarta tudo)", policerRate);
+    cmd.AddValue("policerBurst", "mitigation=policer: rajada em bytes do bucket de um dispositivo isolado", policerBurst);
+    cmd.AddValue("actionMode", "Acao: binary (a > 0.5 isola) ou rate (o policer deixa passar a * taxa base do dispositivo; 1 = sem limite)", actionMode);
+    cmd.AddValue("rateBaseline", "actionMode=rate: taxa base por dispositivo (vazio = carga media do OnOff normal, ~107bps)", rateBaseline);
+    cmd.AddValue("rateLevels", "actionMode=rate: niveis em que a acao [0,1] e quantizada", rateLevels);
     cmd.AddValue("staticNd",    "Popula neighbor cache (ND estatico)", staticNd);
     cmd.AddValue("radioQueue",  "Fila do radio em pacotes (0 = default)", radioQueue);
+    cmd.AddValue("radioQdisc",  "Fila do radio: fifo, fq (DRR por fluxo) ou fqcodel (fq + CoDel)", radioQdisc);
+    cmd.AddValue("fqKey",       "fq: chave das sub-filas, flow (5-tupla); source e rejeitada", fqKey);
+    cmd.AddValue("fqFlows",     "fq: numero de sub-filas", fqFlows);
+    cmd.AddValue("fqQuantum",   "fq: bytes servidos por sub-fila a cada rodada", fqQuantum);
     cmd.AddValue("tracing",     "Habilita pcap", tracing);
     cmd.AddValue("tag",         "Sufixo dos arquivos de saida", tag);
     cmd.Parse(argc, argv);
 
     g_attack = attack; // Passa para a variável global
+    g_tag = tag;
+    if (obsBackend != "flowmon" && obsBackend != "trace") {
+        std::cerr << "obsBackend invalido: " << obsBackend << " (use flowmon ou trace)\n";
+        return 1;
+    }
+    g_traceObs = (obsBackend == "trace");
+    std::string badFeature;
+    if (!ParseTrafficFeatures(obsFeatures, g_obsFeat, badFeature)) {
+        std::cerr << "obsFeatures invalido: '" << badFeature << "'\n";
+        return 1;
+    }
+    if (!ParseObsEncoding(obsEncoding, g_obsEnc)) {
+        std::cerr << "obsEncoding invalido: " << obsEncoding << " (use dense, sparse, quant8 ou quant16)\n";
+        return 1;
+    }
+    if (gymTransport != "zmq" && gymTransport != "shm") {
+        std::cerr << "gymTransport invalido: " << gymTransport << " (use zmq ou shm)\n";
+        return 1;
+    }
+    if (g_stackK < 1 || (g_stackK > 1 && g_obsEnc != OBS_DENSE)) {
+        std::cerr << "stackK invalido: " << g_stackK << " (>= 1; acima de 1 so com obsEncoding=dense)\n";
+        return 1;
+    }
+    if (gymTransport == "shm" && g_obsEnc != OBS_DENSE) {
+        std::cerr << "gymTransport=shm so aceita obsEncoding=dense\n";
+        return 1;
+    }
+    if (gymAsync && (gymTransport != "shm" || decisionLatency < 0.0)) {
+        std::cerr << "gymAsync exige gymTransport=shm e decisionLatency >= 0\n";
+        return 1;
+    }
+    bool usesEwma = std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_EWMA_BYTES) != g_obsFeat.end() ||
+                    std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_EWMA_PKTS) != g_obsFeat.end();
+    if (usesEwma && !ParseHorizons(ewmaHorizons, g_ewmaHorizons)) {
+        std::cerr << "ewmaHorizons invalido: " << ewmaHorizons << "\n";
+        return 1;
+    }
+    // So bytes/s continua no caminho antigo; qualquer outra combinacao sai
+    // das estatisticas por intervalo dos contadores de trace
+    g_featureObs = !(g_obsFeat.size() == 1 && g_obsFeat[0] == FEAT_TX_BYTES);
     g_nNodes = nMonitored;
+    g_obsStack.Init(g_stackK, g_nNodes * ObservationColumns());
+    if (aiMode != "gym" && aiMode != "iforest") {
+        std::cerr << "aiMode invalido: " << aiMode << " (use gym ou iforest)\n";
+        return 1;
+    }
+    if (useAi && aiMode == "iforest") {
+        std::string err;
+        if (!g_forest.Load(forestFile, err)) {
+            std::cerr << "forestFile " << forestFile << ": " << err << "\n";
+            return 1;
+        }
+        if (g_forest.GetNFeatures() != ObservationColumns() || g_stackK > 1) {
+            std::cerr << "modelo com " << g_forest.GetNFeatures() << " features, observacao com "
+                      << ObservationColumns() << " por no (e stackK=1)\n";
+            return 1;
+        }
+        g_policy.Init(g_nNodes, maxIsolations, isolationCooldown, g_forest.GetGate(), maxTotalIsolations);
+    }
+    if (g_adaptiveStep && (!useAi || aiMode != "gym" || g_stackK > 1 || fineStep <= 0.0 || coarseStep < fineStep)) {
+        std::cerr << "adaptiveStep exige useAi=true, aiMode=gym, stackK=1 e 0 < fineStep <= coarseStep\n";
+        return 1;
+    }
+    g_stepper.Init(coarseStep, fineStep, stepIdle, stepLearn, stepHold, stepSigmas);
+    if (radioQdisc != "fifo" && radioQdisc != "fq" && radioQdisc != "fqcodel") {
+        std::cerr << "radioQdisc invalida: " << radioQdisc << " (use fifo, fq ou fqcodel)\n";
+        return 1;
+    }
+    if (radioQdisc != "fifo" && (radioQueue == 0 || fqFlows == 0 || fqQuantum == 0 || fqKey != "flow")) {
+        // Cada fila de saida aqui e de um radio so, com uma origem so (o
+        // proprio no): com fqKey=source todo pacote cairia na mesma sub-fila
+        std::cerr << "radioQdisc=" << radioQdisc << " exige radioQueue, fqFlows e fqQuantum > 0 e fqKey flow"
+                  << " (source nao separa nada numa saida de uma origem so)\n";
+        return 1;
+    }
+    if (mitigation != "node" && mitigation != "policer" && mitigation != "macdeny") {
+        std::cerr << "mitigation invalida: " << mitigation << " (use node, policer ou macdeny)\n";
+        return 1;
+    }
+    if (mitigation == "macdeny") {
+        g_macDeny = CreateObject<MacDenyList>();
+        g_macDeny->TraceConnectWithoutContext("MacDenyDrop", MakeCallback(&MacDenyDropCb));
+    }
+    if (mitigation == "policer") {
+        DataRateValue rate;
+        if (!rate.DeserializeFromString(policerRate, MakeDataRateChecker())) {
+            std::cerr << "policerRate invalida: " << policerRate << "\n";
+            return 1;
+        }
+        if (rate.Get().GetBitRate() > 0 && policerBurst == 0) {
+            std::cerr << "policerRate > 0 exige policerBurst >= tamanho de um pacote\n";
+            return 1;
+        }
+        g_policer = Create<SourcePolicerTable>();
+        g_policerRate = rate.Get().GetBitRate();
+        g_policerBurst = policerBurst;
+    }
+    if (actionMode != "binary" && actionMode != "rate") {
+        std::cerr << "actionMode invalido: " << actionMode << " (use binary ou rate)\n";
+        return 1;
+    }
+    if (actionMode == "rate") {
+        // O OnOff normal manda um pacote de 20 bytes por ciclo de OffTime
+        // 1-2 s: a carga media e 20*8/1.5 ~ 107bps (os 50kbps sao so o pico)
+        if (rateBaseline.empty()) rateBaseline = std::to_string((uint64_t)std::ceil(20 * 8 / 1.5)) + "bps";
+        DataRateValue base;
+        if (mitigation != "policer" || policerBurst == 0 || rateLevels < 2 || rateLevels > 1000 ||
+            !base.DeserializeFromString(rateBaseline, MakeDataRateChecker()) || base.Get().GetBitRate() == 0) {
+            std::cerr << "actionMode=rate exige mitigation=policer, policerBurst > 0, rateBaseline > 0 e 2 <= rateLevels <= 1000\n";
+            return 1;
+        }
+        g_rateBaseline = base.Get().GetBitRate();
+        g_actionDelta.SetLevels(rateLevels);
+    }
+    if (!recordFile.empty() && (!useAi || aiMode != "gym" || g_obsEnc != OBS_DENSE)) {
+        std::cerr << "recordFile exige useAi=true, aiMode=gym e obsEncoding=dense\n";
+        return 1;
+    }
+    if (forkAt > 0.0) {
+        std::string err;
+        if (!ParseBranches(branches, g_branchSpecs, err)) {
+            std::cerr << "branches invalido: " << err << "\n";
+            return 1;
+        }
+        // Socket ZMQ, segmento shm e pcap seriam compartilhados pelos filhos
+        if ((useAi && aiMode == "gym") || tracing || forkAt >= 900.0) {
+            std::cerr << "forkAt exige IA desligada ou aiMode=iforest, tracing=false e forkAt < 900\n";
+            return 1;
+        }
+    }
     const uint32_t K = (nMonitored + nodesPerPan - 1) / nodesPerPan;
     
     NS_LOG_UNCOND("==========================================================");
     NS_LOG_UNCOND("AP central com " << K << " radios (canais), " << nMonitored << " dispositivos");
     NS_LOG_UNCOND("ATAQUE DDoS LIGADO? " << (g_attack ? "SIM" : "NAO"));
-    NS_LOG_UNCOND("AGENTE IA LIGADO?   " << (useAi ? "SIM" : "NAO (Rodando Nativo)"));
+    NS_LOG_UNCOND("AGENTE IA LIGADO?   " << (useAi ? "SIM (" + aiMode + ")" : std::string("NAO (Rodando Nativo)")));
+    NS_LOG_UNCOND("OBSERVACAO VIA:     " << obsBackend << " [" << obsFeatures << "]");
+    NS_LOG_UNCOND("FILA DO RADIO:      " << radioQdisc << " (" << radioQueue << "p)");
     NS_LOG_UNCOND("==========================================================");
 
     monitoredNodes.Create(nMonitored);
@@ -265,6 +665,7 @@ int main(int argc, char* argv[]) {
     std::vector<NetDeviceContainer> panSix(K);
     std::vector<uint32_t> panSliceLen(K);
     std::vector<Ptr<NetDevice>> monSix(nMonitored, nullptr);
+    g_nodeLrDev.assign(nMonitored, nullptr);
 
     for (uint32_t k = 0; k < K; ++k) {
         uint32_t startIdx = k * nodesPerPan;
@@ -300,7 +701,9 @@ int main(int argc, char* argv[]) {
             if (!ld) continue;
             ld->GetCsmaCa()->SetMacMaxCSMABackoffs(5);  
             ld->GetMac()->SetMacMaxFrameRetries(7); 
+            if (di > 0) g_nodeLrDev[startIdx + di - 1] = ld;
         }
+        if (g_macDeny) g_macDeny->Install(DynamicCast<LrWpanNetDevice>(dev.Get(0)));
 
         SixLowPanHelper sixlow;
         NetDeviceContainer six = sixlow.Install(dev);
@@ -318,10 +721,21 @@ int main(int argc, char* argv[]) {
 
     if (radioQueue > 0) {
         TrafficControlHelper tch;
-        tch.SetRootQueueDisc("ns3::FifoQueueDisc", "MaxSize",
-                             StringValue(std::to_string(radioQueue) + "p"));
+        std::string maxSize = std::to_string(radioQueue) + "p";
+        if (radioQdisc == "fifo")
+            tch.SetRootQueueDisc("ns3::FifoQueueDisc", "MaxSize", StringValue(maxSize));
+        else
+            tch.SetRootQueueDisc("ns3::SourceFqQueueDisc", "MaxSize", StringValue(maxSize),
+                                 "Flows", UintegerValue(fqFlows), "Quantum", UintegerValue(fqQuantum),
+                                 "Key", StringValue(fqKey), "UseCoDel", BooleanValue(radioQdisc == "fqcodel"));
         for (uint32_t k = 0; k < K; ++k) tch.Install(panSix[k]);
     }
+    // O AP e o destino do trafego dos dispositivos, que nunca passa por uma
+    // fila de saida dele: o policer fica na entrada de cada radio do AP
+    if (g_policer) {
+        g_policerIngress = CreateObject<SourcePolicerIngress>(g_policer);
+        for (uint32_t k = 0; k < K; ++k) g_policerIngress->Install(panSix[k].Get(0));
+    }
 
     Ipv6AddressHelper address;
     std::vector<Ipv6Address> apAddr(K);   
@@ -358,6 +772,16 @@ int main(int argc, char* argv[]) {
         attackerIdx.push_back(idx);
     }
 
+    // Tabela de identidade para o agente: PAN = k + 1; atacantes entram nas duas ondas
+    g_reward.Init(nMonitored, rewardAttackWeight, rewardBenignCost);
+    g_nodeAddr.assign(nMonitored, Ipv6Address::GetAny());
+    for (uint32_t i = 0; i < nMonitored; ++i) {
+        std::string role = (g_attack && attackerSet.count(i)) ? "atk" : "normal";
+        g_nodeInfo.Add(i, monitoredNodes.Get(i), i / nodesPerPan + 1, role);
+        g_reward.SetRole(i, role);
+        g_nodeAddr[i] = NodeGlobalAddress(monitoredNodes.Get(i));
+    }
+
     uint16_t normalPort = 9002, attackPort = 9001;
     PacketSinkHelper sinkN("ns3::UdpSocketFactory", Inet6SocketAddress(Ipv6Address::GetAny(), normalPort));
     PacketSinkHelper sinkA("ns3::UdpSocketFactory", Inet6SocketAddress(Ipv6Address::GetAny(), attackPort));
@@ -365,6 +789,9 @@ int main(int argc, char* argv[]) {
     ApplicationContainer s2 = sinkA.Install(apNode.Get(0));
     s1.Start(Seconds(1.0)); s1.Stop(Seconds(900.0));
     s2.Start(Seconds(1.0)); s2.Stop(Seconds(900.0));
+    g_sinkApps.Add(s1);
+    g_sinkApps.Add(s2);
+    g_reward.SetSinks(s1.Get(0), s2.Get(0));
 
     // =================================================================
     //  Tráfego NORMAL: Uniforme Assíncrono (Sem Picos)
@@ -376,7 +803,7 @@ int main(int argc, char* argv[]) {
     for (uint32_t i = 0; i < nMonitored; ++i) {
         uint32_t k = i / nodesPerPan;
         OnOffHelper onoff("ns3::UdpSocketFactory", Inet6SocketAddress(apAddr[k], normalPort));
-        onoff.SetAttribute("DataRate",   StringValue("50kbps"));
+        onoff.SetAttribute("DataRate",   StringValue("50kbps"));   // pico; a carga media (rateBaseline) sai de PacketSize e OffTime
         onoff.SetAttribute("PacketSize", UintegerValue(20)); 
         onoff.SetAttribute("OnTime",  StringValue("ns3::ConstantRandomVariable[Constant=0.001]"));
         onoff.SetAttribute("OffTime", StringValue("ns3::UniformRandomVariable[Min=1.0|Max=2.0]"));
@@ -395,7 +822,7 @@ int main(int argc, char* argv[]) {
             uint32_t k = node / nodesPerPan; // Roteamento Correto
             
             OnOffHelper atk("ns3::UdpSocketFactory", Inet6SocketAddress(apAddr[k], attackPort));
-            atk.SetAttribute("DataRate",   StringValue("5Mbps"));
+            atk.SetAttribute("DataRate",   StringValue(g_attackRate));
             atk.SetAttribute("PacketSize", UintegerValue(1000)); 
             atk.SetAttribute("OnTime",  StringValue("ns3::ConstantRandomVariable[Constant=15]"));
             atk.SetAttribute("OffTime", StringValue("ns3::ConstantRandomVariable[Constant=0]"));
@@ -404,11 +831,30 @@ int main(int argc, char* argv[]) {
             ApplicationContainer app1 = atk.Install(monitoredNodes.Get(node));
             app1.Start(Seconds(170.0 + (j % 5))); // Jitter para o ns-3 não travar
             app1.Stop(Seconds(220.0));
+            g_attackApps.Add(app1);
 
             // ONDA 2: Inicia aos 250s e termina aos 300s
             ApplicationContainer app2 = atk.Install(monitoredNodes.Get(node));
             app2.Start(Seconds(250.0 + (j % 5))); // Jitter para o ns-3 não travar
             app2.Stop(Seconds(300.0));
+            g_attackApps.Add(app2);
+        }
+    }
+    // Handle por dispositivo para o MyExecuteActions: a aplicacao 0 e a normal
+    g_actionDelta.Init(nMonitored);
+    g_nodeApps.assign(nMonitored, {});
+    for (uint32_t i = 0; i < nMonitored; ++i) {
+        Ptr<Node> node = monitoredNodes.Get(i);
+        for (uint32_t a = 0; a < node->GetNApplications(); ++a) {
+            Ptr<OnOffApplication> onoff = DynamicCast<OnOffApplication>(node->GetApplication(a));
+            if (onoff) g_nodeApps[i].push_back(onoff);
+        }
+    }
+    for (const BranchSpec &b : g_branchSpecs) {
+        std::string err;
+        if (!ApplyBranch(b, false, err)) {
+            std::cerr << err << "\n";
+            return 1;
         }
     }
     Config::ConnectWithoutContext("/NodeList/*/DeviceList/*/$ns3::LrWpanNetDevice/Mac/MacTxDrop", MakeCallback(&MacTxDropCb));
@@ -418,7 +864,11 @@ int main(int argc, char* argv[]) {
     Config::ConnectWithoutContext("/NodeList/*/$ns3::TrafficControlLayer/RootQueueDiscList/*/Drop", MakeCallback(&QueueDropCb));
 
     InstallFlowMonitor();
-    Simulator::Schedule(Seconds(899.9), &SaveFlowMonXml, tag);
+    if (g_traceObs || g_featureObs) {
+        bool stampTx = std::find(g_obsFeat.begin(), g_obsFeat.end(), FEAT_DELAY) != g_obsFeat.end();
+        InstallTrafficCounters(monitoredNodes, apNode, stampTx, g_ewmaHorizons);
+    }
+    Simulator::Schedule(Seconds(899.9), &SaveFlowMonXml);
     g_flowCsv.open("flowmon_persec_" + tag + ".csv");
     g_flowCsv << "tempo,normal_tx_pps,normal_rx_pps,ataque_tx_pps,ataque_rx_pps\n";
     Simulator::Schedule(Seconds(1.0), &LogFlowPerSecond);
@@ -426,24 +876,71 @@ int main(int argc, char* argv[]) {
     // =================================================================
     // MÓDULO DE INTELIGÊNCIA ARTIFICIAL (OpenGym)
     // =================================================================
-    if (useAi) {
-        uint32_t openGymPort = 5555; double envStepTime = 1.0;
-        Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
-        openGym->SetGetObservationSpaceCb(MakeCallback(&MyGetObservationSpace));
-        openGym->SetGetActionSpaceCb(MakeCallback(&MyGetActionSpace));
-        openGym->SetGetObservationCb(MakeCallback(&MyGetObservation));
-        openGym->SetGetRewardCb(MakeCallback(&MyGetReward));
-        openGym->SetGetGameOverCb(MakeCallback(&MyGetGameOver));
-        openGym->SetGetExtraInfoCb(MakeCallback(&MyGetExtraInfo));
-        openGym->SetExecuteActionsCb(MakeCallback(&MyExecuteActions));
-        Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, openGym);
+    if (useAi && aiMode == "iforest") {
+        NS_LOG_UNCOND("[INFO] Isolation Forest nativo: " << g_forest.GetNTrees() << " arvores, "
+                      << g_forest.GetNFeatures() << " features, limite " << g_forest.GetGate() << " B/s");
+        Simulator::Schedule(Seconds(1.0), &NativeDetectorStep, 1.0);
+    } else if (useAi) {
+        double envStepTime = 1.0;
+        Callback<void> notify;
+        if (!recordFile.empty()) g_recorder = CreateObject<GymRecorder>(recordFile);
+        if (gymTransport == "shm") {
+            std::vector<uint32_t> shape = ObservationShape();
+            uint32_t obsCap = 1;
+            for (uint32_t d : shape) obsCap *= d;
+            // Async: observacoes em voo ate a acao chegar = floor(latencia / periodo) + 1
+            double period = (g_adaptiveStep ? fineStep : envStepTime) * g_stackK;
+            uint32_t nSlots = gymAsync ? (uint32_t)std::floor(decisionLatency / period) + 2 : 2;
+            Ptr<ShmGymInterface> shm = CreateObject<ShmGymInterface>(
+                "/ddos_gym_" + std::to_string(openGymPort), obsCap, g_nNodes, 256 + 64 * g_nNodes, nSlots);
+            if (gymAsync) shm->SetAsync(Seconds(decisionLatency));
+            ConnectGym(shm);
+            notify = MakeCallback(&ShmGymInterface::NotifyCurrentState, shm);
+        } else {
+            Ptr<OpenGymInterface> openGym = CreateObject<OpenGymInterface>(openGymPort);
+            ConnectGym(openGym);
+            notify = MakeCallback(&OpenGymInterface::NotifyCurrentState, openGym);
+        }
+        Simulator::Schedule(Seconds(0.0), &ScheduleNextStateRead, envStepTime, notify);
+        if (g_adaptiveStep) Simulator::Schedule(Seconds(fineStep), &AdaptiveStepProbe, envStepTime, notify);
     } else {
         NS_LOG_UNCOND("[INFO] OpenGym Desligado. Os pacotes vao voar sem censura da IA!");
     }
 
+    if (forkAt > 0.0) {
+        NS_LOG_UNCOND("[FORK] " << g_branchSpecs.size() << " ramos a partir de t=" << forkAt << "s");
+        Simulator::Schedule(Seconds(forkAt), &ForkBranches);
+    }
+
     Simulator::ScheduleDestroy(&ImprimirDescartes);
+    g_prof.AddSince(PROF_SETUP, setupT0);
     Simulator::Stop(Seconds(915.0)); 
     Simulator::Run();
+    if (g_branches.IsParent()) {
+        ReportBranches(g_branchSpecs, g_branches, "normal_tx_pkts,normal_rx_pkts,ataque_tx_pkts,ataque_rx_pkts,isolamentos",
+                       "fork_results_" + tag + ".csv");
+        g_flowCsv.close();
+        Simulator::Destroy();
+        return 0;
+    }
+    g_prof.Report(std::cout, g_nNodes);
+    if (useAi && aiMode == "iforest")
+        std::cout << "[IFOREST] isolamentos no total: " << g_policy.GetTotalIsolations() << "\n";
+    if (useAi) std::cout << "[REWARD] " << g_reward.Summary() << "\n";
+    if (g_policer)
+        std::cout << "[POLICER] " << g_policer->GetNDropped() << " pacotes (" << g_policer->GetDroppedBytes()
+                  << " bytes) descartados, " << g_policer->GetNPassed() << " passaram\n";
+    if (g_macDeny)
+        std::cout << "[MACDENY] " << g_macDeny->GetNDropped() << " quadros descartados na MAC do AP\n";
+    if (g_branches.IsChild()) g_branches.Report(BranchSummary());
+    if (g_adaptiveStep)
+        std::cout << "[STEP] " << g_stepTick << " leituras do agente, " << g_stepper.GetNFires()
+                  << " disparos (baseline da vitima " << g_stepper.GetMean() << " +- " << g_stepper.GetStd() << " B/s)\n";
+    if (g_recorder) {
+        g_recorder->Close();
+        std::cout << "[INFO] Gravacao: " << g_recorder->GetNStates() << " estados, "
+                  << g_recorder->GetNActions() << " acoes em " << recordFile << "\n";
+    }
     g_flowCsv.close();
     Simulator::Destroy();
     return 0;
@@ -0,0 +1,350 @@
+// =============================================================================
+//  Contadores de trafego por no alimentados direto pelas trace sources
+//
+//  Backend de observacao alternativo ao FlowMonitor. Cada no monitorado tem
+//  os traces Tx/Rx do seu Ipv6L3Protocol (e o Tx dos SixLowPanNetDevice, nos
+//  cenarios LR-WPAN) ligados a callbacks que ja carregam o indice do no, de
+//  modo que cada pacote so incrementa uma posicao de vetores contiguos.
+//  Ler a observacao e uma passada linear sobre os nos: nada de
+//  CheckForLostPackets() nem de copiar GetFlowStats(), e o custo por passo
+//  cresce com o numero de nos, nao com o numero de fluxos.
+//
+//  Diferenca em relacao ao FlowMonitor: aqui entra todo pacote IPv6 que o no
+//  envia (inclusive ICMPv6/ND), nao so os fluxos UDP/TCP classificados.
+//
+//  Alem dos contadores acumulados, cada no mantem estatisticas do intervalo
+//  corrente (atualizadas pacote a pacote), de onde sai a observacao N x F
+//  com as features escolhidas em --obsFeatures:
+//    txBytes   bytes/s enviados          txPkts    pacotes/s enviados
+//    meanSize  tamanho medio (bytes)     iatVar    variancia do intervalo
+//                                                  entre envios (s^2)
+//    delivery  fracao entregue ao sink   delay     atraso medio ate o sink (s)
+//    drops     descartes MAC Tx + PHY Rx do proprio radio, por segundo
+//    ewmaBytes bytes/s EWMA, uma coluna por horizonte de --ewmaHorizons
+//    ewmaPkts  pacotes/s EWMA, idem (ver ddos_feature_engine.h)
+//
+//  Uso:
+//    InstallTrafficCounters(monitoredNodes, sinks); // depois do enderecamento
+//    const std::vector<float> &tp = TrafficTxRates();       // bytes/s por no
+//    TrafficFeatureMatrix(feats, buf);                      // N x F, row-major
+// =============================================================================
+#ifndef DDOS_TRACE_COUNTERS_H
+#define DDOS_TRACE_COUNTERS_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/lr-wpan-module.h"
+#include "ns3/network-module.h"
+#include "ns3/sixlowpan-module.h"
+
+#include "ddos_feature_engine.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+// Contadores acumulados (desde o inicio) por no, em vetores paralelos
+struct NodeTrafficCounters
+{
+    std::vector<uint64_t> txBytes, txPkts;        // Ipv6L3Protocol Tx (pacote IPv6 inteiro)
+    std::vector<uint64_t> rxBytes, rxPkts;        // Ipv6L3Protocol Rx
+    std::vector<uint64_t> sixTxBytes, sixTxPkts;  // SixLowPanNetDevice Tx (ja comprimido)
+
+    void Resize(uint32_t n)
+    {
+        txBytes.assign(n, 0);    txPkts.assign(n, 0);
+        rxBytes.assign(n, 0);    rxPkts.assign(n, 0);
+        sixTxBytes.assign(n, 0); sixTxPkts.assign(n, 0);
+    }
+};
+
+// Estatisticas do intervalo corrente; zeradas a cada TrafficFeatureMatrix()
+struct NodeIntervalStats
+{
+    std::vector<uint64_t> txBytes;
+    std::vector<uint32_t> txPkts;
+    std::vector<int64_t>  lastTxTs;          // ticks do ultimo envio (persiste)
+    std::vector<uint32_t> iatN;              // Welford sobre os intervalos entre envios
+    std::vector<double>   iatMean, iatM2;
+    std::vector<uint32_t> sinkRxPkts;        // pacotes do no recebidos nos sinks
+    std::vector<double>   delaySum;          // soma dos atrasos desses pacotes (s)
+    std::vector<uint32_t> drops;             // MacTxDrop + PhyRxDrop do radio do no
+
+    void Resize(uint32_t n)
+    {
+        txBytes.assign(n, 0); txPkts.assign(n, 0);
+        lastTxTs.assign(n, -1);
+        iatN.assign(n, 0); iatMean.assign(n, 0.0); iatM2.assign(n, 0.0);
+        sinkRxPkts.assign(n, 0); delaySum.assign(n, 0.0);
+        drops.assign(n, 0);
+    }
+
+    // Zera o intervalo; lastTxTs fica para o primeiro gap do proximo
+    void Reset()
+    {
+        std::fill(txBytes.begin(), txBytes.end(), 0);
+        std::fill(txPkts.begin(), txPkts.end(), 0);
+        std::fill(iatN.begin(), iatN.end(), 0);
+        std::fill(iatMean.begin(), iatMean.end(), 0.0);
+        std::fill(iatM2.begin(), iatM2.end(), 0.0);
+        std::fill(sinkRxPkts.begin(), sinkRxPkts.end(), 0);
+        std::fill(delaySum.begin(), delaySum.end(), 0.0);
+        std::fill(drops.begin(), drops.end(), 0);
+    }
+};
+
+enum TrafficFeature
+{
+    FEAT_TX_BYTES,
+    FEAT_TX_PKTS,
+    FEAT_MEAN_SIZE,
+    FEAT_IAT_VAR,
+    FEAT_DELIVERY,
+    FEAT_DELAY,
+    FEAT_DROPS,
+    FEAT_EWMA_BYTES,   // ocupa uma coluna por horizonte
+    FEAT_EWMA_PKTS,    // idem
+};
+
+// Carimbo do instante de envio, posto no Tx do IPv6 do no de origem e lido
+// no Rx do sink (mesma ideia das tags do FlowMonitor)
+class TrafficTxTimeTag : public Tag
+{
+  public:
+    TrafficTxTimeTag() {}
+    explicit TrafficTxTimeTag(int64_t txTs) : m_txTs(txTs) {}
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::TrafficTxTimeTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("Ddos")
+                                .AddConstructor<TrafficTxTimeTag>();
+        return tid;
+    }
+    TypeId GetInstanceTypeId() const override { return GetTypeId(); }
+    uint32_t GetSerializedSize() const override { return 8; }
+    void Serialize(TagBuffer i) const override { i.WriteU64((uint64_t)m_txTs); }
+    void Deserialize(TagBuffer i) override { m_txTs = (int64_t)i.ReadU64(); }
+    void Print(std::ostream &os) const override { os << "txTs=" << m_txTs; }
+
+    int64_t GetTxTs() const { return m_txTs; }
+
+  private:
+    int64_t m_txTs{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TrafficTxTimeTag);
+
+static NodeTrafficCounters g_traffic;
+static NodeIntervalStats g_trafficIv;
+static std::unordered_map<Ipv6Address, uint32_t, Ipv6AddressHash> g_trafficAddrToNode;
+static std::vector<uint64_t> g_trafficLastTx;   // txBytes na ultima leitura
+static std::vector<float> g_trafficRates;       // bytes/s por no na ultima leitura
+static Time g_trafficLastRead;
+static Time g_trafficIvStart;                   // inicio do intervalo das features
+static bool g_trafficStampTx = false;           // so carimba Tx se 'delay' for usado
+static RateEwmaEngine g_ewma;                   // vazio (H = 0) se nenhuma feature ewma*
+
+static void TrafficIpv6Tx(uint32_t idx, Ptr<const Packet> p, Ptr<Ipv6>, uint32_t)
+{
+    uint32_t size = p->GetSize();
+    g_traffic.txBytes[idx] += size;
+    g_traffic.txPkts[idx]++;
+
+    int64_t now = Simulator::Now().GetTimeStep();
+    g_trafficIv.txBytes[idx] += size;
+    g_trafficIv.txPkts[idx]++;
+    if (g_trafficIv.lastTxTs[idx] >= 0) {
+        double gap = TimeStep(now - g_trafficIv.lastTxTs[idx]).GetSeconds();
+        uint32_t n = ++g_trafficIv.iatN[idx];
+        double d = gap - g_trafficIv.iatMean[idx];
+        g_trafficIv.iatMean[idx] += d / n;
+        g_trafficIv.iatM2[idx] += d * (gap - g_trafficIv.iatMean[idx]);
+    }
+    g_trafficIv.lastTxTs[idx] = now;
+    if (g_ewma.IsEnabled()) g_ewma.OnPacket(idx, now, size);
+    if (g_trafficStampTx) p->AddByteTag(TrafficTxTimeTag(now));
+}
+
+static void TrafficIpv6Rx(uint32_t idx, Ptr<const Packet> p, Ptr<Ipv6>, uint32_t)
+{
+    g_traffic.rxBytes[idx] += p->GetSize();
+    g_traffic.rxPkts[idx]++;
+}
+
+static void TrafficSixTx(uint32_t idx, Ptr<const Packet> p, Ptr<SixLowPanNetDevice>, uint32_t)
+{
+    g_traffic.sixTxBytes[idx] += p->GetSize();
+    g_traffic.sixTxPkts[idx]++;
+}
+
+static void TrafficRadioDrop(uint32_t idx, Ptr<const Packet>)
+{
+    g_trafficIv.drops[idx]++;
+}
+
+// Rx no sink: atribui entrega e atraso ao no de origem do pacote
+static void TrafficSinkRx(Ptr<const Packet> p, Ptr<Ipv6>, uint32_t)
+{
+    Ipv6Header h;
+    p->PeekHeader(h);
+    auto it = g_trafficAddrToNode.find(h.GetSource());
+    if (it == g_trafficAddrToNode.end()) return;
+    uint32_t idx = it->second;
+    g_trafficIv.sinkRxPkts[idx]++;
+    TrafficTxTimeTag tag;
+    if (p->FindFirstMatchingByteTag(tag))
+        g_trafficIv.delaySum[idx] += TimeStep(Simulator::Now().GetTimeStep() - tag.GetTxTs()).GetSeconds();
+}
+
+// Liga os traces de cada no (o indice no container vira o indice do vetor) e
+// o Rx dos sinks. Chame depois do enderecamento IPv6. stampTx liga a tag de
+// instante de envio, necessaria so para a feature 'delay'; ewmaHorizons (s)
+// liga o motor EWMA das features ewmaBytes/ewmaPkts.
+static void InstallTrafficCounters(const NodeContainer &nodes, const NodeContainer &sinks,
+                                   bool stampTx = false,
+                                   const std::vector<double> &ewmaHorizons = std::vector<double>())
+{
+    uint32_t n = nodes.GetN();
+    g_traffic.Resize(n);
+    g_trafficIv.Resize(n);
+    g_trafficLastTx.assign(n, 0);
+    g_trafficRates.assign(n, 0.0f);
+    g_trafficLastRead = Simulator::Now();
+    g_trafficIvStart = Simulator::Now();
+    g_trafficAddrToNode.clear();
+    g_trafficStampTx = stampTx;
+    g_ewma.Init(n, ewmaHorizons);
+
+    for (uint32_t i = 0; i < n; ++i) {
+        Ptr<Node> node = nodes.Get(i);
+        Ptr<Ipv6L3Protocol> l3 = node->GetObject<Ipv6L3Protocol>();
+        if (l3) {
+            l3->TraceConnectWithoutContext("Tx", MakeBoundCallback(&TrafficIpv6Tx, i));
+            l3->TraceConnectWithoutContext("Rx", MakeBoundCallback(&TrafficIpv6Rx, i));
+            for (uint32_t ifIdx = 0; ifIdx < l3->GetNInterfaces(); ++ifIdx) {
+                if (l3->GetNAddresses(ifIdx) < 2) continue;   // so link-local
+                g_trafficAddrToNode[l3->GetAddress(ifIdx, 1).GetAddress()] = i;
+            }
+        }
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d) {
+            Ptr<NetDevice> dev = node->GetDevice(d);
+            Ptr<SixLowPanNetDevice> six = DynamicCast<SixLowPanNetDevice>(dev);
+            if (six) six->TraceConnectWithoutContext("Tx", MakeBoundCallback(&TrafficSixTx, i));
+            Ptr<LrWpanNetDevice> lr = DynamicCast<LrWpanNetDevice>(dev);
+            if (lr) {
+                lr->GetMac()->TraceConnectWithoutContext("MacTxDrop", MakeBoundCallback(&TrafficRadioDrop, i));
+                lr->GetPhy()->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&TrafficRadioDrop, i));
+            }
+        }
+    }
+
+    for (uint32_t s = 0; s < sinks.GetN(); ++s) {
+        Ptr<Ipv6L3Protocol> l3 = sinks.Get(s)->GetObject<Ipv6L3Protocol>();
+        if (l3) l3->TraceConnectWithoutContext("Rx", MakeCallback(&TrafficSinkRx));
+    }
+}
+
+// Bytes/s transmitidos por no desde a leitura anterior. O intervalo e o tempo
+// simulado real entre leituras (na primeira leitura, em t=0, vale 1 s).
+static const std::vector<float>& TrafficTxRates()
+{
+    double dt = (Simulator::Now() - g_trafficLastRead).GetSeconds();
+    if (dt <= 0.0) dt = 1.0;
+    g_trafficLastRead = Simulator::Now();
+
+    const uint32_t n = g_traffic.txBytes.size();
+    for (uint32_t i = 0; i < n; ++i) {
+        uint64_t cur = g_traffic.txBytes[i];
+        g_trafficRates[i] = (float)((double)(cur - g_trafficLastTx[i]) / dt);
+        g_trafficLastTx[i] = cur;
+    }
+    return g_trafficRates;
+}
+
+// "txBytes,delay,..." -> lista de features. Retorna false se algum nome for
+// desconhecido (o nome invalido vai em 'bad').
+static bool ParseTrafficFeatures(const std::string &csv, std::vector<TrafficFeature> &out, std::string &bad)
+{
+    static const std::pair<const char *, TrafficFeature> names[] = {
+        {"txBytes", FEAT_TX_BYTES}, {"txPkts", FEAT_TX_PKTS}, {"meanSize", FEAT_MEAN_SIZE},
+        {"iatVar", FEAT_IAT_VAR},   {"delivery", FEAT_DELIVERY}, {"delay", FEAT_DELAY},
+        {"drops", FEAT_DROPS},      {"ewmaBytes", FEAT_EWMA_BYTES}, {"ewmaPkts", FEAT_EWMA_PKTS},
+    };
+    out.clear();
+    std::stringstream ss(csv);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        if (tok.empty()) continue;
+        bool found = false;
+        for (const auto &nm : names) {
+            if (tok == nm.first) { out.push_back(nm.second); found = true; break; }
+        }
+        if (!found) { bad = tok; return false; }
+    }
+    return !out.empty();
+}
+
+// Numero de colunas por no (as features EWMA ocupam uma por horizonte)
+static uint32_t TrafficFeatureColumns(const std::vector<TrafficFeature> &feats, uint32_t nHorizons)
+{
+    uint32_t cols = 0;
+    for (TrafficFeature f : feats)
+        cols += (f == FEAT_EWMA_BYTES || f == FEAT_EWMA_PKTS) ? nHorizons : 1;
+    return cols;
+}
+
+// Fecha o intervalo corrente: escreve a matriz N x F (row-major, uma linha
+// por no, colunas na ordem de 'feats') em 'out' e zera os acumuladores.
+static void TrafficFeatureMatrix(const std::vector<TrafficFeature> &feats, std::vector<float> &out)
+{
+    double dt = (Simulator::Now() - g_trafficIvStart).GetSeconds();
+    if (dt <= 0.0) dt = 1.0;
+    g_trafficIvStart = Simulator::Now();
+
+    const uint32_t n = g_trafficIv.txBytes.size();
+    const uint32_t H = g_ewma.GetNHorizons();
+    const uint32_t F = TrafficFeatureColumns(feats, H);
+    const int64_t nowTs = Simulator::Now().GetTimeStep();
+    out.resize((size_t)n * F);
+    for (uint32_t i = 0; i < n; ++i) {
+        float *row = &out[(size_t)i * F];
+        uint32_t pk = g_trafficIv.txPkts[i];
+        uint32_t rx = g_trafficIv.sinkRxPkts[i];
+        uint32_t c = 0;
+        for (TrafficFeature feat : feats) {
+            if (feat == FEAT_EWMA_BYTES) {
+                for (uint32_t h = 0; h < H; ++h) row[c++] = (float)g_ewma.ByteRate(i, h, nowTs);
+                continue;
+            }
+            if (feat == FEAT_EWMA_PKTS) {
+                for (uint32_t h = 0; h < H; ++h) row[c++] = (float)g_ewma.PktRate(i, h, nowTs);
+                continue;
+            }
+            double v = 0.0;
+            switch (feat) {
+            case FEAT_TX_BYTES:  v = g_trafficIv.txBytes[i] / dt; break;
+            case FEAT_TX_PKTS:   v = pk / dt; break;
+            case FEAT_MEAN_SIZE: v = pk ? (double)g_trafficIv.txBytes[i] / pk : 0.0; break;
+            case FEAT_IAT_VAR:   v = g_trafficIv.iatN[i] > 1 ? g_trafficIv.iatM2[i] / (g_trafficIv.iatN[i] - 1) : 0.0; break;
+            // Sem envio no intervalo nao ha o que perder: entrega 1
+            case FEAT_DELIVERY:  v = pk ? std::min(1.0, (double)rx / pk) : 1.0; break;
+            case FEAT_DELAY:     v = rx ? g_trafficIv.delaySum[i] / rx : 0.0; break;
+            case FEAT_DROPS:     v = g_trafficIv.drops[i] / dt; break;
+            default: break;
+            }
+            row[c++] = (float)v;
+        }
+    }
+    g_trafficIv.Reset();
+}
+
+} // namespace ns3
+
+#endif // DDOS_TRACE_COUNTERS_H
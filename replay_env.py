@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+replay_env.py
+
+Reproduz, sem simulador, execuções gravadas com --recordFile (ddos_80215,
+ddos_sweep1 ou ddos_opengym). Expõe a mesma API do ns3env.Ns3Env que o
+agent_isolation.py usa: reset(), step(action), action_space.shape, .last e
+close(). O arquivo inteiro é carregado na memória, então um episódio de 900 s
+roda na velocidade do agente, não na do 802.15.4.
+
+O replay é em malha aberta: a observação seguinte é sempre a da execução
+gravada, qualquer que seja a ação pedida agora. Serve para iterar limiares,
+modelos e features do detector; o efeito das ações na rede continua a exigir
+o ns-3. As ações que o agente daria ficam em env.actions; com dict_info=True
+o info traz também a ação que a gravação aplicou depois de cada estado
+(info["recorded_action"]).
+
+Formato: ver ddos_gym_recorder.h.
+
+Exemplo:
+  ./ns3 run "scratch/ddos_80215 --recordFile=run1.ddrec" &
+  python3 agent_isolation.py                      # grava uma execução
+  python3 agent_isolation.py --transport replay --replay-file run1.ddrec
+
+Linha de comando (resumo de um arquivo):
+  python3 replay_env.py run1.ddrec
+"""
+
+import argparse
+import struct
+from types import SimpleNamespace
+
+try:
+    import numpy as np
+except Exception:  # sem numpy as observações viram listas
+    np = None
+
+MAGIC = b"DDOSREC1"
+VERSION = 1
+
+FILE_HEADER = struct.Struct("<8sII")
+STATE_HEAD = struct.Struct("<dfBB")     # t, reward, gameOver, nDims (depois do tipo)
+ACTION_HEAD = struct.Struct("<dI")      # t, n
+
+
+# Ações --delta-actions ([-1, i0, a0, ...], ddos_action_delta.h) viram densas
+# sobre a última decisão conhecida; a primeira ação de um episódio é densa
+def _expand_action(act, prev):
+    if len(act) == 0 or act[0] >= 0 or prev is None:
+        return act
+    dense = prev.copy() if np is not None else list(prev)
+    for k in range(1, len(act) - 1, 2):
+        i = int(act[k])
+        if 0 <= i < len(dense):
+            dense[i] = act[k + 1]
+    return dense
+
+
+def _floats(buf, off, n, shape=None):
+    if np is not None:
+        a = np.frombuffer(buf, dtype=np.float32, count=n, offset=off).copy()
+        return a.reshape(shape) if shape and len(shape) > 1 else a
+    return list(struct.unpack_from("<%df" % n, buf, off))
+
+
+# Lê um arquivo gravado: lista de passos (obs, reward, done, info, t) e, para
+# cada passo, a ação aplicada depois dele na gravação (None no último)
+def load_recording(path):
+    with open(path, "rb") as f:
+        buf = f.read()
+    magic, version, _ = FILE_HEADER.unpack_from(buf, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("%s não é uma gravação %s versão %d" % (path, MAGIC.decode(), VERSION))
+    off = FILE_HEADER.size
+    states, actions = [], []
+    pending = 0   # primeiro estado ainda sem ação
+    prev = None   # última ação densa (para expandir as esparsas)
+    while off < len(buf):
+        kind = buf[off:off + 1]
+        off += 1
+        if kind == b"S":
+            t, reward, done, n_dims = STATE_HEAD.unpack_from(buf, off)
+            off += STATE_HEAD.size
+            shape = struct.unpack_from("<%dI" % n_dims, buf, off)
+            off += 4 * n_dims
+            n = 1
+            for d in shape:
+                n *= d
+            obs = _floats(buf, off, n, shape)
+            off += 4 * n
+            (info_len,) = struct.unpack_from("<I", buf, off)
+            off += 4
+            info = buf[off:off + info_len].decode("utf-8", "replace")
+            off += info_len
+            states.append((obs, float(reward), bool(done), info, t))
+            actions.append(None)
+        elif kind == b"A":
+            t, n = ACTION_HEAD.unpack_from(buf, off)
+            off += ACTION_HEAD.size
+            act = _expand_action(_floats(buf, off, n), prev)
+            off += 4 * n
+            if len(act) and act[0] >= 0:
+                prev = act
+            # Respostas chegam na ordem dos estados (com --gymAsync, depois
+            # de outros estados já publicados)
+            if pending < len(actions):
+                actions[pending] = act
+                pending += 1
+        else:
+            raise ValueError("%s: registro desconhecido %r no byte %d (arquivo truncado?)" % (path, kind, off - 1))
+    return states, actions
+
+
+class ReplayNs3Env:
+    def __init__(self, paths, loop=True, dict_info=False):
+        if isinstance(paths, str):
+            paths = [paths]
+        self.episodes = [load_recording(p) for p in paths]
+        if not any(states for states, _ in self.episodes):
+            raise ValueError("nenhum estado gravado em %s" % ", ".join(paths))
+        self.loop = loop
+        self.dict_info = dict_info
+        self.episode = -1
+        self.pos = 0
+        self.last = None
+        self.actions = []
+        # Sem nenhuma ação gravada (episódio de um passo) usa o nº de linhas da obs
+        n_act = next((len(a) for _, acts in self.episodes for a in acts if a is not None),
+                     len(next(states for states, _ in self.episodes if states)[0][0]))
+        self.action_space = SimpleNamespace(shape=(n_act,))
+        self.observation_space = None
+
+    def _serve(self):
+        states, actions = self.episodes[self.episode]
+        obs, reward, done, info, t = states[self.pos]
+        if self.dict_info:
+            info = {"info": info, "t": t, "recorded_action": actions[self.pos]}
+        self.last = (obs, reward, done, info)
+        return self.last
+
+    # Próximo episódio (arquivo); no fim da lista volta ao primeiro se loop
+    def reset(self):
+        nxt = self.episode + 1
+        if nxt >= len(self.episodes):
+            if not self.loop and self.episode >= 0:
+                raise RuntimeError("todas as gravações já foram reproduzidas")
+            nxt = 0
+        self.episode = nxt
+        self.pos = 0
+        self.actions = []
+        return self._serve()[0]
+
+    def step(self, action):
+        if self.episode < 0:
+            self.reset()
+        self.actions.append(action)
+        states = self.episodes[self.episode][0]
+        if self.pos + 1 >= len(states):
+            obs = self.last[0] if self.last else None
+            return obs, 0.0, True, self.last[3] if self.last else ""
+        self.pos += 1
+        return self._serve()
+
+    def close(self):
+        self.episodes = []
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Resumo de gravações --recordFile")
+    parser.add_argument("files", nargs="+")
+    args = parser.parse_args()
+    for path in args.files:
+        states, actions = load_recording(path)
+        if not states:
+            print("%s: vazio" % path)
+            continue
+        shape = np.asarray(states[0][0]).shape if np is not None else (len(states[0][0]),)
+        print("%s: %d estados, %d ações, obs %s, t=%.1f..%.1f s, done=%s"
+              % (path, len(states), sum(a is not None for a in actions), shape,
+                 states[0][4], states[-1][4], states[-1][2]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+shm_env.py
+
+Lado Python do transporte por memória compartilhada (ddos_shm_gym.h),
+usado quando o cenário roda com --gymTransport=shm. Expõe a mesma API do
+ns3env.Ns3Env que o agent_isolation.py usa: reset(), step(action),
+action_space.shape e close().
+
+O ns-3 cria /dev/shm/<nome> (padrão: ddos_gym_<porta>) e publica cada
+observação incrementando obsHead; o agente responde escrevendo a ação no anel
+e incrementando actHead. A espera é um FUTEX_WAIT (via ctypes) sobre esses
+contadores, então não há polling nem serialização protobuf no caminho.
+
+Com --gymAsync o ns-3 não para à espera da ação: ela é aplicada em
+t_obs + --decisionLatency (tempo simulado). Do lado do agente nada muda; a
+ação i continua a ser a resposta à observação i.
+
+O agente grava o próprio pid no cabeçalho e marca 'detached' no close(); o
+ns-3 encerra o episódio se o agente sair (ou morrer) enquanto ele espera uma
+ação. Um segmento cujo simPid já não existe é sobra de uma simulação morta
+antes do Close() e é ignorado até o ns-3 novo recriá-lo.
+
+Exemplo:
+  ./ns3 run "scratch/ddos_80215 --gymTransport=shm" &
+  python3 agent_isolation.py --transport shm
+"""
+
+import ctypes
+import errno
+import mmap
+import os
+import platform
+import struct
+import time
+from types import SimpleNamespace
+
+try:
+    import numpy as np
+except Exception:  # o transporte em si não depende de numpy
+    np = None
+
+MAGIC = 0x4D594744  # "DGYM"
+VERSION = 2
+
+HEADER = struct.Struct("<8I3I5I")              # 64 bytes
+OFF_OBS_HEAD, OFF_ACT_HEAD, OFF_CLOSED = 32, 36, 40
+OFF_DETACHED, OFF_SIM_PID, OFF_AGENT_PID = 44, 48, 52
+SLOT = struct.Struct("<II4IIIfId")             # 48 bytes
+
+FUTEX_WAIT, FUTEX_WAKE = 0, 1
+SYS_FUTEX = {"x86_64": 202, "aarch64": 98, "i686": 240, "armv7l": 240}.get(platform.machine(), 202)
+
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+def _pid_alive(pid):
+    try:
+        os.kill(pid, 0)
+    except OSError as e:
+        return e.errno != errno.ESRCH
+    return True
+
+
+# Segmento utilizável: layout inicializado, simulação aberta e viva
+def _segment_ready(mm):
+    magic, version = struct.unpack_from("<II", mm, 0)
+    if magic != MAGIC:
+        return False
+    if version != VERSION:
+        raise RuntimeError(f"versão do layout shm {version} != {VERSION}")
+    closed, = struct.unpack_from("<I", mm, OFF_CLOSED)
+    sim_pid, = struct.unpack_from("<I", mm, OFF_SIM_PID)
+    return not closed and _pid_alive(sim_pid)
+
+
+class ShmNs3Env:
+    def __init__(self, name="ddos_gym_5555", connect_timeout=60.0, debug=False):
+        self.name = name.lstrip("/")
+        self.debug = debug
+        path = os.path.join("/dev/shm", self.name)
+
+        # Espera o ns-3 criar e inicializar o segmento (magic é escrito por
+        # último); segmentos de simulações mortas ou fechadas são ignorados
+        deadline = time.time() + connect_timeout
+        while True:
+            try:
+                fd = os.open(path, os.O_RDWR)
+                size = os.fstat(fd).st_size
+                if size >= HEADER.size:
+                    self.mm = mmap.mmap(fd, size, mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE)
+                    os.close(fd)
+                    if _segment_ready(self.mm):
+                        break
+                    self.mm.close()
+                else:
+                    os.close(fd)
+            except FileNotFoundError:
+                pass
+            if time.time() > deadline:
+                raise TimeoutError(f"segmento {path} não apareceu ou é de uma simulação morta (o ns-3 está com --gymTransport=shm?)")
+            time.sleep(0.05)
+
+        (_, _, self.n_slots, self.obs_cap, self.act_cap, self.info_cap,
+         self.obs_slot_bytes, self.act_slot_bytes) = HEADER.unpack_from(self.mm, 0)[:8]
+        self.sim_pid, = struct.unpack_from("<I", self.mm, OFF_SIM_PID)
+
+        self._obs_head = ctypes.c_uint32.from_buffer(self.mm, OFF_OBS_HEAD)
+        self._act_head = ctypes.c_uint32.from_buffer(self.mm, OFF_ACT_HEAD)
+        self._closed = ctypes.c_uint32.from_buffer(self.mm, OFF_CLOSED)
+        self._detached = ctypes.c_uint32.from_buffer(self.mm, OFF_DETACHED)
+        struct.pack_into("<I", self.mm, OFF_AGENT_PID, os.getpid())
+        self._obs_base = HEADER.size
+        self._act_base = HEADER.size + self.n_slots * self.obs_slot_bytes
+
+        self.next_obs = 0       # próxima observação a consumir
+        self.sent = 0           # ações já publicadas
+        self.last = None
+        self.action_space = SimpleNamespace(shape=(self.act_cap,))
+        self.observation_space = None
+
+    # ---------------- futex ----------------
+    def _futex(self, word, op, val, timeout=None):
+        ts = None
+        if timeout is not None:
+            ts = ctypes.byref(_Timespec(int(timeout), int((timeout % 1) * 1e9)))
+        return _libc.syscall(SYS_FUTEX, ctypes.c_void_p(ctypes.addressof(word)),
+                             op, ctypes.c_uint32(val), ts, None, 0)
+
+    def _wait_obs(self, seq):
+        # Espera obsHead > seq; False se a simulação fechou (ou morreu) antes
+        while True:
+            head = self._obs_head.value
+            if 0 < ((head - seq) & 0xFFFFFFFF) < 0x80000000:
+                return True
+            if self._closed.value or not _pid_alive(self.sim_pid):
+                return False
+            self._futex(self._obs_head, FUTEX_WAIT, head, timeout=1.0)
+
+    # ---------------- slots ----------------
+    def _read_obs(self, seq):
+        off = self._obs_base + (seq % self.n_slots) * self.obs_slot_bytes
+        (_, n_dims, s0, s1, s2, s3, obs_len, info_len,
+         reward, game_over, sim_time) = SLOT.unpack_from(self.mm, off)
+        shape = (s0, s1, s2, s3)[:n_dims]
+        data_off = off + SLOT.size
+        if np is not None:
+            obs = np.frombuffer(self.mm, dtype=np.float32, count=obs_len, offset=data_off).copy()
+            if n_dims > 1:
+                obs = obs.reshape(shape)
+        else:
+            obs = list(struct.unpack_from(f"<{obs_len}f", self.mm, data_off))
+        info_off = data_off + 4 * self.obs_cap
+        info = bytes(self.mm[info_off:info_off + info_len]).decode("utf-8", "replace")
+        self.last = (obs, float(reward), bool(game_over), info)
+        if self.debug:
+            print(f"[shm] obs #{seq} t={sim_time:.3f}s len={obs_len} done={bool(game_over)}")
+        return self.last
+
+    def _write_action(self, action):
+        seq = self.sent
+        off = self._act_base + (seq % self.n_slots) * self.act_slot_bytes
+        if np is not None:
+            a = np.asarray(action, dtype=np.float32).ravel()[: self.act_cap]
+            struct.pack_into("<II", self.mm, off, a.size, 0)
+            self.mm[off + 8: off + 8 + 4 * a.size] = a.tobytes()
+        else:
+            a = [float(x) for x in action][: self.act_cap]
+            struct.pack_into(f"<II{len(a)}f", self.mm, off, len(a), 0, *a)
+        self.sent = seq + 1
+        self._act_head.value = self.sent
+        self._futex(self._act_head, FUTEX_WAKE, 0x7FFFFFFF)
+
+    # ---------------- API estilo gym ----------------
+    def reset(self):
+        if not self._wait_obs(self.next_obs):
+            raise RuntimeError("simulação terminou antes da primeira observação")
+        obs = self._read_obs(self.next_obs)[0]
+        self.next_obs += 1
+        return obs
+
+    def step(self, action):
+        self._write_action(action)
+        if not self._wait_obs(self.next_obs):
+            obs = self.last[0] if self.last else None
+            return obs, 0.0, True, ""
+        obs, reward, done, info = self._read_obs(self.next_obs)
+        self.next_obs += 1
+        return obs, reward, done, info
+
+    def close(self):
+        # Avisa o ns-3 que ninguém vai mais responder (ele encerra o episódio)
+        if getattr(self, "_detached", None) is not None:
+            self._detached.value = 1
+            self._futex(self._act_head, FUTEX_WAKE, 0x7FFFFFFF)
+        for ref in ("_obs_head", "_act_head", "_closed", "_detached"):
+            setattr(self, ref, None)
+        try:
+            self.mm.close()
+        except BufferError:
+            pass
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""
+vec_env.py
+
+Ambiente vetorizado: um agente conduz N simuladores ns-3 independentes
+(sementes e parâmetros diferentes), cada um num processo próprio. A cada
+passo as N ações são espalhadas e as N observações voltam juntas num lote
+(N_env, nós) ou (N_env, nós, F). Enquanto um simulador calcula o intervalo
+seguinte os outros também calculam, então numa máquina de 32 núcleos o
+agente deixa de esperar por uma única simulação single-thread.
+
+Cada instância i recebe:
+  --openGymPort=<base_port + i>   (ZMQ; no shm vira /dev/shm/ddos_gym_<porta>)
+  --RngRun=<seed + i>             (semente do ns-3; reinícios usam seed + i + k*N)
+  os parâmetros de sim_args (um dict para todas ou uma lista com um por instância)
+e roda com --cwd=<run_dir>/env<i>, para os CSV/XML de saída não colidirem.
+
+Reinício (autoreset): depois do done o ns-3 ainda grava as saídas e fecha o
+transporte, então o agente espera o processo sair antes de relançar. Cada
+instância roda numa sessão própria e, se não sair a tempo, o grupo inteiro
+(./ns3 run e o simulador filho) é morto; o segmento /dev/shm é removido
+antes do relançamento. Assim nem um órfão nem um segmento velho atrapalham
+a instância nova.
+
+Exemplo:
+  from vec_env import VecNs3Env
+  venv = VecNs3Env(8, ns3_dir="~/ns-allinone-3.40/ns-3.40",
+                   sim_args={"obsFeatures": "txBytes,txPkts"}, transport="shm")
+  obs = venv.reset()                      # (8, N) ou (8, N, F)
+  obs, rew, done, info = venv.step(acoes) # acoes: (8, N)
+  venv.close()
+
+Linha de comando (smoke test com ações neutras):
+  python3 vec_env.py --n-envs 4 --ns3-dir ~/ns-3.40 --transport shm --steps 20
+"""
+
+import argparse
+import os
+import shlex
+import signal
+import subprocess
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+try:
+    import numpy as np
+except Exception:  # sem numpy o lote vira lista de listas
+    np = None
+
+
+def _format_args(args):
+    return " ".join("--%s=%s" % (k, v) for k, v in args.items())
+
+
+def _killpg(pgid, sig):
+    try:
+        os.killpg(pgid, sig)
+    except ProcessLookupError:
+        pass
+
+
+class VecNs3Env:
+    def __init__(self, n_envs, scenario="scratch/ddos_80215", ns3_dir=".", sim_args=None,
+                 base_port=5555, seed=1, transport="shm", run_dir="vec_runs",
+                 autoreset=True, build=True, connect_timeout=120.0, exit_timeout=60.0):
+        if transport not in ("shm", "zmq"):
+            raise ValueError("transport deve ser shm ou zmq")
+        self.n_envs = n_envs
+        self.scenario = scenario
+        self.ns3_dir = os.path.abspath(os.path.expanduser(ns3_dir))
+        self.base_port = base_port
+        self.seed = seed
+        self.transport = transport
+        self.run_dir = os.path.abspath(run_dir)
+        self.autoreset = autoreset
+        self.connect_timeout = connect_timeout
+        self.exit_timeout = exit_timeout
+        if sim_args is None or isinstance(sim_args, dict):
+            sim_args = [dict(sim_args or {}) for _ in range(n_envs)]
+        if len(sim_args) != n_envs:
+            raise ValueError("sim_args precisa de um dict por instância")
+        self.sim_args = sim_args
+
+        # Compila uma vez; as N instâncias rodam com --no-build para não
+        # disputarem o mesmo build
+        if build:
+            subprocess.run([os.path.join(self.ns3_dir, "ns3"), "build", os.path.basename(scenario)],
+                           cwd=self.ns3_dir, check=True)
+
+        self.procs = [None] * n_envs
+        self.envs = [None] * n_envs
+        self.restarts = [0] * n_envs
+        self.pool = ThreadPoolExecutor(max_workers=n_envs)
+        list(self.pool.map(self._launch, range(n_envs)))
+
+        shapes = {tuple(e.action_space.shape) for e in self.envs}
+        if len(shapes) != 1:
+            raise RuntimeError("instâncias com espaços de ação diferentes: %s" % shapes)
+        self.action_shape = shapes.pop()
+
+    # ---------------- processos ----------------
+    def _launch(self, i):
+        port = self.base_port + i
+        run = self.seed + i + self.restarts[i] * self.n_envs
+        args = dict(self.sim_args[i])
+        args.update({"openGymPort": port, "RngRun": run})
+        if self.transport == "shm":
+            args["gymTransport"] = "shm"
+        cwd = os.path.join(self.run_dir, "env%d" % i)
+        os.makedirs(cwd, exist_ok=True)
+        cmd = [os.path.join(self.ns3_dir, "ns3"), "run", "--no-build", "--cwd=" + cwd,
+               "%s %s" % (self.scenario, _format_args(args))]
+        # O filho herda uma cópia do descritor; a nossa fecha aqui (nada vaza a cada reinício)
+        with open(os.path.join(cwd, "sim.log"), "w") as log:
+            log.write("$ %s\n" % " ".join(shlex.quote(c) for c in cmd))
+            log.flush()
+            self.procs[i] = subprocess.Popen(cmd, cwd=self.ns3_dir, stdout=log, stderr=subprocess.STDOUT,
+                                             start_new_session=True)
+        self.envs[i] = self._connect(port)
+
+    def _connect(self, port):
+        if self.transport == "shm":
+            from shm_env import ShmNs3Env
+            return ShmNs3Env(name="ddos_gym_%d" % port, connect_timeout=self.connect_timeout)
+        from ns3gym import ns3env
+        return ns3env.Ns3Env(port=port, stepTime=1.0, startSim=False, simSeed=0, simArgs={}, debug=False)
+
+    def _restart(self, i):
+        # Depois do done: deixa o ns-3 terminar as saídas antes de relançar
+        self._stop(i, self.exit_timeout)
+        self.restarts[i] += 1
+        self._launch(i)
+        return self.envs[i].reset()
+
+    def _stop(self, i, grace=5.0):
+        env, proc = self.envs[i], self.procs[i]
+        if env is not None:
+            try:
+                env.close()   # shm: marca detached e o ns-3 encerra o episódio
+            except Exception:
+                pass
+        if proc is not None:
+            try:
+                proc.wait(timeout=grace)
+            except subprocess.TimeoutExpired:
+                _killpg(proc.pid, signal.SIGTERM)
+                try:
+                    proc.wait(timeout=10)
+                except subprocess.TimeoutExpired:
+                    pass
+            # O wrapper pode sair antes do simulador: o grupo inteiro vai junto
+            _killpg(proc.pid, signal.SIGKILL)
+            proc.wait()
+        if self.transport == "shm":
+            try:
+                os.unlink("/dev/shm/ddos_gym_%d" % (self.base_port + i))
+            except FileNotFoundError:
+                pass
+        self.envs[i] = self.procs[i] = None
+
+    # ---------------- lote ----------------
+    def _batch(self, items):
+        if np is None:
+            return list(items)
+        return np.stack([np.asarray(x, dtype=np.float32) for x in items])
+
+    def reset(self):
+        return self._batch(self.pool.map(lambda e: e.reset(), self.envs))
+
+    def _step_one(self, i, action):
+        obs, reward, done, info = self.envs[i].step(action)
+        if done and self.autoreset:
+            # Devolve o estado final em info e já entrega a 1a observação da nova rodada
+            info = {"info": info, "terminal_observation": obs}
+            obs = self._restart(i)
+        return obs, reward, done, info
+
+    # actions: (N_env, nós); cada linha vai para uma instância
+    def step(self, actions):
+        results = list(self.pool.map(self._step_one, range(self.n_envs), list(actions)))
+        obs, rewards, dones, infos = zip(*results)
+        if np is not None:
+            return self._batch(obs), np.asarray(rewards, dtype=np.float32), np.asarray(dones), list(infos)
+        return list(obs), list(rewards), list(dones), list(infos)
+
+    def neutral_actions(self):
+        if np is not None:
+            return np.zeros((self.n_envs,) + self.action_shape, dtype=np.float32)
+        return [[0.0] * self.action_shape[0] for _ in range(self.n_envs)]
+
+    def close(self):
+        for i in range(self.n_envs):
+            self._stop(i)
+        self.pool.shutdown(wait=False)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Smoke test do ambiente vetorizado")
+    parser.add_argument("--n-envs", type=int, default=4)
+    parser.add_argument("--ns3-dir", type=str, default=".")
+    parser.add_argument("--scenario", type=str, default="scratch/ddos_80215")
+    parser.add_argument("--transport", choices=["shm", "zmq"], default="shm")
+    parser.add_argument("--base-port", type=int, default=5555)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--steps", type=int, default=20)
+    parser.add_argument("--sim-arg", action="append", default=[],
+                        help="parâmetro repassado a todas as instâncias, ex: --sim-arg nMonitored=500")
+    args = parser.parse_args()
+
+    sim_args = dict(a.split("=", 1) for a in args.sim_arg)
+    venv = VecNs3Env(args.n_envs, scenario=args.scenario, ns3_dir=args.ns3_dir, sim_args=sim_args,
+                     base_port=args.base_port, seed=args.seed, transport=args.transport)
+    try:
+        t0 = time.time()
+        venv.reset()
+        for _ in range(args.steps):
+            venv.step(venv.neutral_actions())
+        dt = time.time() - t0
+        print("%d instâncias x %d passos em %.2f s (%.1f passos/s no total)"
+              % (args.n_envs, args.steps, dt, args.n_envs * args.steps / dt))
+    finally:
+        venv.close()
+
+
+if __name__ == "__main__":
+    main()